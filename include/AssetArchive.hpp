@@ -0,0 +1,139 @@
+#ifndef ENGINE_ASSET_ARCHIVE_HPP
+#define ENGINE_ASSET_ARCHIVE_HPP
+
+// shared with the tools, so this header only depends on the standard library
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+
+/**
+ * Layout of the packed asset archive written by tools/asset-packer (make pack-assets).
+ *
+ *   Header
+ *   Entry[bucketCount]  open addressing hash table over the asset paths, hash 0 marks an empty bucket
+ *   names               the asset paths (relative to the assets directory, '/' separated) without terminators
+ *   data                the file contents, every file starts at a multiple of dataAlignment
+ *
+ * All offsets are relative to the start of the archive, so the whole file can be mapped and used in place.
+ */
+namespace NovaEngine::AssetArchive
+{
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t entryCount;
+		uint32_t bucketCount; // power of two
+		uint32_t reserved;
+		uint64_t namesOffset;
+		uint64_t dataOffset;
+	};
+
+	struct Entry
+	{
+		uint64_t hash;
+		uint64_t offset;
+		uint64_t size;
+		uint32_t nameOffset;
+		uint32_t nameLength;
+	};
+
+	constexpr char fileMagic[8] = { 'N', 'O', 'V', 'A', 'P', 'A', 'K', '\0' };
+	constexpr uint32_t fileVersion = 1;
+
+	/* the data section starts page aligned, files inside it are aligned for vector loads */
+	constexpr size_t sectionAlignment = 4096;
+	constexpr size_t dataAlignment = 64;
+
+	constexpr uint64_t alignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	/* FNV-1a, never 0 so empty buckets stay distinguishable */
+	constexpr uint64_t hash(std::string_view path)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (char c : path)
+		{
+			hash ^= static_cast<unsigned char>(c);
+			hash *= 1099511628211ull;
+		}
+		return hash == 0 ? 1 : hash;
+	}
+
+	/* fewer than half of the buckets are used, so probe sequences stay short */
+	constexpr uint32_t bucketCountFor(uint32_t entryCount)
+	{
+		uint32_t count = 16;
+		while (count < entryCount * 2)
+			count <<= 1;
+		return count;
+	}
+
+	/** @returns false if the archive is too small, of another version or its tables or any used bucket point outside of it */
+	inline bool validate(const char* archive, size_t size)
+	{
+		if (size < sizeof(Header))
+			return false;
+
+		Header header;
+		memcpy(&header, archive, sizeof(header));
+
+		if (memcmp(header.magic, fileMagic, sizeof(fileMagic)) != 0 || header.version != fileVersion)
+			return false;
+
+		if (header.bucketCount == 0 || (header.bucketCount & (header.bucketCount - 1)) != 0)
+			return false;
+
+		uint64_t tableEnd = sizeof(Header) + static_cast<uint64_t>(header.bucketCount) * sizeof(Entry);
+		if (tableEnd > header.namesOffset || header.namesOffset > header.dataOffset || header.dataOffset > size)
+			return false;
+
+		// find() compares names in place, so every used bucket has to stay inside the names and data sections
+		uint64_t namesSize = header.dataOffset - header.namesOffset;
+		for (uint32_t i = 0; i < header.bucketCount; i++)
+		{
+			Entry entry;
+			memcpy(&entry, archive + sizeof(Header) + i * sizeof(Entry), sizeof(entry));
+
+			if (entry.hash == 0)
+				continue;
+
+			if (static_cast<uint64_t>(entry.nameOffset) + entry.nameLength > namesSize)
+				return false;
+
+			if (entry.offset < header.dataOffset || entry.offset > size || entry.size > size - entry.offset)
+				return false;
+		}
+
+		return true;
+	}
+
+	/** @returns nullptr if the archive has no asset with that path, the archive has to be validated first */
+	inline const Entry* find(const char* archive, std::string_view path)
+	{
+		const Header* header = reinterpret_cast<const Header*>(archive);
+		const Entry* table = reinterpret_cast<const Entry*>(archive + sizeof(Header));
+		const char* names = archive + header->namesOffset;
+
+		uint64_t pathHash = hash(path);
+		uint32_t mask = header->bucketCount - 1;
+
+		for (uint32_t i = static_cast<uint32_t>(pathHash) & mask, probes = 0; probes <= mask; i = (i + 1) & mask, probes++)
+		{
+			const Entry& entry = table[i];
+
+			if (entry.hash == 0)
+				return nullptr;
+
+			if (entry.hash == pathHash && std::string_view(names + entry.nameOffset, entry.nameLength) == path)
+				return &entry;
+		}
+
+		return nullptr;
+	}
+};
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef ENGINE_ASSET_DEPENDENCIES_HPP
+#define ENGINE_ASSET_DEPENDENCIES_HPP
+
+// shared with the tools, so this header only depends on the standard library
+#include <cctype>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Dependency metadata written by tools/asset-cooker into assets.deps at the root of the assets directory.
+ * One line per asset that depends on others: the asset path followed by the paths of its direct dependencies,
+ * separated by tabs. All paths are relative to the assets directory and '/' separated.
+ */
+namespace NovaEngine::AssetDependencies
+{
+	constexpr const char* fileName = "assets.deps";
+
+	/* sorted, so the same assets always produce the same file */
+	typedef std::map<std::string, std::vector<std::string>, std::less<>> Graph;
+
+	inline std::string format(const Graph& graph)
+	{
+		std::string text;
+
+		for (const auto& [asset, dependencies] : graph)
+		{
+			if (dependencies.empty())
+				continue;
+
+			text += asset;
+			for (const std::string& dependency : dependencies)
+				text += "\t" + dependency;
+			text += "\n";
+		}
+
+		return text;
+	}
+
+	inline void parse(std::string_view text, Graph& graph)
+	{
+		while (!text.empty())
+		{
+			size_t lineEnd = text.find('\n');
+			std::string_view line = text.substr(0, lineEnd);
+			text.remove_prefix(lineEnd == std::string_view::npos ? text.size() : lineEnd + 1);
+
+			size_t separator = line.find('\t');
+			if (separator == std::string_view::npos || separator == 0)
+				continue;
+
+			std::vector<std::string>& dependencies = graph[std::string(line.substr(0, separator))];
+
+			while (separator != std::string_view::npos)
+			{
+				line.remove_prefix(separator + 1);
+				separator = line.find('\t');
+
+				std::string_view dependency = line.substr(0, separator);
+				if (!dependency.empty())
+					dependencies.emplace_back(dependency);
+			}
+		}
+	}
+
+	/* appends the literal arguments of every require("...") in a script, as they are written */
+	inline void findRequires(std::string_view script, std::vector<std::string>& requiredPaths)
+	{
+		constexpr std::string_view call = "require(";
+
+		for (size_t position = script.find(call); position != std::string_view::npos; position = script.find(call, position))
+		{
+			// part of another identifier, e.g. myrequire(
+			bool isIdentifier = position > 0 && (isalnum(static_cast<unsigned char>(script[position - 1])) || script[position - 1] == '_' || script[position - 1] == '$' || script[position - 1] == '.');
+			position += call.size();
+
+			if (isIdentifier)
+				continue;
+
+			while (position < script.size() && isspace(static_cast<unsigned char>(script[position])))
+				position++;
+
+			if (position >= script.size() || (script[position] != '"' && script[position] != '\''))
+				continue;
+
+			char quote = script[position++];
+			size_t end = script.find(quote, position);
+			if (end == std::string_view::npos)
+				break;
+
+			requiredPaths.emplace_back(script.substr(position, end - position));
+			position = end + 1;
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef ENGINE_ASSET_HANDLE_HPP
+#define ENGINE_ASSET_HANDLE_HPP
+
+#include "framework.hpp"
+#include "AssetView.hpp"
+#include "job_system/Job.hpp"
+
+namespace NovaEngine
+{
+	namespace JobSystem
+	{
+		class JobScheduler;
+	}
+
+	class AssetManager;
+
+	/**
+	 * Pending result of AssetManager::loadAsync(). A job suspends in co_await handle until the
+	 * I/O thread finished the load and is requeued by it, other threads can block in wait().
+	 */
+	class AssetHandle
+	{
+	private:
+		struct Waiter
+		{
+			JobSystem::JobHandle handle;
+			JobSystem::JobScheduler* scheduler;
+		};
+
+		struct State
+		{
+			State(const char* path, JobSystem::JobPriority priority) : path(path), priority(priority) {}
+
+			std::string path;
+			JobSystem::JobPriority priority;
+
+			std::mutex mutex;
+			std::condition_variable doneCv;
+			bool isDone = false;
+			bool isLoaded = false;
+			AssetView view;
+			std::vector<Waiter> waiters;
+
+			void complete(bool isLoaded, AssetView view);
+		};
+
+		std::shared_ptr<State> state_;
+
+		AssetHandle(std::shared_ptr<State> state) : state_(std::move(state)) {}
+
+		bool suspend(JobSystem::JobHandle handle);
+
+		friend class AssetManager;
+
+	public:
+		struct Awaiter
+		{
+			AssetHandle& asset;
+
+			bool await_ready() { return asset.isDone(); }
+			bool await_suspend(JobSystem::JobHandle handle) { return asset.suspend(handle); }
+
+			/** @returns false if the asset could not be loaded */
+			bool await_resume() { return asset.isLoaded(); }
+		};
+
+		AssetHandle() : state_() {}
+
+		/* only usable from within a job */
+		Awaiter operator co_await() { return { *this }; }
+
+		/** @returns false if the asset could not be loaded, blocks the calling thread until then */
+		bool wait();
+
+		bool isDone();
+		bool isLoaded();
+
+		/* empty until the load finished */
+		AssetView view();
+
+		const std::string& path() const { return state_->path; }
+		inline bool isValid() const { return state_ != nullptr; }
+	};
+};
+
+#endif
@@ -4,6 +4,40 @@
 #include "SubSystem.hpp"
 #include "framework.hpp"
 #include "Utils.hpp"
+#include "AssetView.hpp"
+#include "AssetHandle.hpp"
+#include "AssetStream.hpp"
+#include "AssetArchive.hpp"
+#include "AssetDependencies.hpp"
+
+/* threads that map asynchronously loaded assets, a read blocking on the disk only stalls one of them */
+#ifndef ENGINE_ASSET_IO_THREADS
+#define ENGINE_ASSET_IO_THREADS 2
+#endif
+
+/* bytes of loaded assets kept around after their last handle is gone */
+#ifndef ENGINE_ASSET_CACHE_BUDGET
+#define ENGINE_ASSET_CACHE_BUDGET (256 * 1024 * 1024)
+#endif
+
+/* defaults of AssetManager::openStream(), memory of a stream is bounded to their product */
+#ifndef ENGINE_ASSET_STREAM_CHUNK_SIZE
+#define ENGINE_ASSET_STREAM_CHUNK_SIZE (1024 * 1024)
+#endif
+
+#ifndef ENGINE_ASSET_STREAM_CHUNKS
+#define ENGINE_ASSET_STREAM_CHUNKS 4
+#endif
+
+/* streams open at once, each one has its own reader thread */
+#ifndef ENGINE_ASSET_MAX_STREAMS
+#define ENGINE_ASSET_MAX_STREAMS 8
+#endif
+
+/* changes to watched assets are collected until none arrived for this long, editors and the cooker write in bursts */
+#ifndef ENGINE_ASSET_RELOAD_DEBOUNCE_MS
+#define ENGINE_ASSET_RELOAD_DEBOUNCE_MS 50
+#endif
 
 namespace NovaEngine
 {
@@ -11,20 +45,229 @@ namespace NovaEngine
 
 	class AssetManager : public SubSystem<const char*>
 	{
+	public:
+		struct CacheStats
+		{
+			size_t hits; // requests served by an already loaded asset
+			size_t coalesced; // requests that joined a load that was still running
+			size_t misses; // requests that had to read the asset
+			size_t evictions;
+			size_t residentBytes; // bytes of the loaded assets in the cache, uncompressed assets of the archive are not counted
+			size_t budget;
+		};
+
+		/* called on the watcher thread with the changed asset paths (relative to the assets directory), heavy work belongs into a job */
+		typedef std::function<void(const std::vector<std::string>& assetPaths)> ReloadListener;
+
 	private:
+		struct PrefetchEntry
+		{
+			std::string path;
+			size_t size = 0;
+			bool isLoaded = false;
+		};
+
+		struct CacheEntry
+		{
+			std::shared_ptr<AssetHandle::State> state;
+			std::list<std::string>::iterator lruPosition;
+			size_t size = 0; // charged against the budget
+			bool isResident = false;
+		};
+
+		static constexpr size_t priorityCount_ = static_cast<size_t>(JobSystem::JobPriority::COUNT);
+
 		std::string rootDir_;
 
+		/* the whole mounted assets.pak, empty when the assets are loose files */
+		AssetView archive_;
+		std::string archivePath_;
+
+		std::vector<std::thread> ioThreads_;
+		std::mutex ioMutex_;
+		std::condition_variable ioCv_;
+		std::queue<std::shared_ptr<AssetHandle::State>> ioQueues_[priorityCount_];
+		bool isIoRunning_;
+
+		/* keyed by asset path, the front of cacheLru_ is the most recently requested asset */
+		std::mutex cacheMutex_;
+		std::unordered_map<std::string, CacheEntry> cache_;
+		std::list<std::string> cacheLru_;
+		CacheStats cacheStats_;
+
+		/* first requests of every asset in order, guarded by cacheMutex_ */
+		bool isRecordingPrefetch_;
+		bool isPrefetchManifestWritten_;
+		std::vector<PrefetchEntry> prefetchRecord_;
+		std::unordered_map<std::string, size_t> prefetchRecordIndex_;
+		std::string prefetchManifestPath_;
+		std::thread prefetchThread_;
+		std::atomic<bool> isPrefetching_;
+
+		/* streams with a running reader thread, see ENGINE_ASSET_MAX_STREAMS */
+		std::atomic<size_t> openStreams_;
+
+		/* assets.deps of the cooker, replaced when it changes on disk */
+		std::mutex dependenciesMutex_;
+		AssetDependencies::Graph dependencies_;
+
+		/* loose files are copied instead of mapped while they are watched */
+		std::atomic<bool> isWatching_;
+		std::thread watchThread_;
+		int watchFd_; // inotify instance, -1 while the assets are not watched
+		int watchWakeFd_; // eventfd that stops the watcher thread
+		std::unordered_map<int, std::string> watchedDirs_; // watch descriptor -> directory relative to rootDir_, only used by the watcher thread
+		std::mutex reloadMutex_;
+		std::vector<ReloadListener> reloadListeners_;
+
+		void ioThreadEntry();
+		void watchThreadEntry();
+
+		/* asks the kernel to read the assets of the manifest ahead, in the order the last recorded run requested them */
+		void prefetchThreadEntry(std::vector<std::string> assetPaths);
+
+		bool readPrefetchManifest(std::vector<std::string>& assetPaths, size_t* bytes);
+		bool writePrefetchManifest();
+
+		/* adds watches for dir and every directory below it, files already in new directories are added to changed */
+		void watchDirectory(const std::string& dir, std::set<std::string>* changed);
+
+		/** @returns the cached (possibly still loading) state of the asset, isNew is set if the caller has to load it */
+		std::shared_ptr<AssetHandle::State> acquireCached(const char* assetPath, JobSystem::JobPriority priority, bool* isNew);
+
+		/* completes the load for every handle and accounts it in the cache, failed loads are not cached */
+		void finishLoad(const std::shared_ptr<AssetHandle::State>& state, bool isLoaded, AssetView view);
+
+		/* has to be called with cacheMutex_ held */
+		void evictUnused();
+
+		bool mountArchive(const std::string& archivePath);
+
+		/* reads the dependency metadata, assets without it are preloaded on their own */
+		void loadDependencies();
+
+		/** @returns false if no archive is mounted or it has no asset with that path */
+		bool findInArchive(const char* assetPath, AssetView& view);
+
+		/* bypasses the cache, populate maps the whole file right away instead of faulting pages in on first access */
+		bool mapAsset(const char* assetPath, AssetView& view, bool populate);
+
+		/* replaces the view of a block compressed asset with its decompressed content, blocks are spread over the scheduler's workers */
+		bool decompress(const char* assetPath, AssetView& view);
+
 	protected:
 		bool onInitialize(const char* execPath);
 		bool onTerminate();
 
 	public:
+		/**
+		 * Maps the asset read only, pages are only read from disk once they are touched.
+		 * The mapping is released together with the last view referencing it once the cache evicted the asset, watched loose files are copied instead.
+		 * @returns false if the asset could not be opened or mapped
+		 */
+		bool mapFile(const char* assetPath, AssetView& view);
+
+		/**
+		 * Queues the asset on the I/O threads, higher priorities are read first.
+		 * The returned handle can be awaited by a job (co_await handle) without blocking its worker.
+		 * Assets that are cached or already loading are not read again, the handle shares that load.
+		 */
+		AssetHandle loadAsync(const char* assetPath, JobSystem::JobPriority priority = JobSystem::JobPriority::NORMAL);
+
+		/**
+		 * Queues the asset together with everything it depends on (directly or not) as one batch on the I/O threads,
+		 * instead of discovering every dependency with its own blocking load. handles receives the root first.
+		 * The handles keep the whole closure cached until they are released, e.g. together by clearing the vector.
+		 */
+		void preload(const char* assetPath, std::vector<AssetHandle>& handles, JobSystem::JobPriority priority = JobSystem::JobPriority::NORMAL);
+
+		/**
+		 * Reads the asset in chunks of chunkSize bytes on a reader thread of the stream, at most chunkCount chunks are in memory at once.
+		 * Streams bypass the cache, they are meant for assets that are read once and are too large to be kept.
+		 * Reader threads are not shared, so at most ENGINE_ASSET_MAX_STREAMS streams are open at once.
+		 * @returns false if the asset could not be opened or too many streams are open
+		 */
+		bool openStream(const char* assetPath, AssetStream& stream, size_t chunkSize = ENGINE_ASSET_STREAM_CHUNK_SIZE, size_t chunkCount = ENGINE_ASSET_STREAM_CHUNKS);
+
+		/* assets without handles are evicted least recently used first while the cache is over budget */
+		void setCacheBudget(size_t bytes);
+
+		CacheStats cacheStats();
+		void logCacheStats();
+
+		/**
+		 * Every run records the order in which assets are first requested, until this turns it off.
+		 * A kept record is written to assets.prefetch next to the executable on terminate,
+		 * the next run reads those assets ahead on a background thread as soon as the AssetManager is initialized.
+		 */
+		void setPrefetchRecording(bool isRecording);
+
+		/**
+		 * Drops the cached asset, the next request reads it again.
+		 * Handles keep their view, which only holds the old content if it was copied (see watch()) or read from the archive.
+		 */
+		void invalidate(const char* assetPath);
+
+		/**
+		 * Watches the loose asset files with inotify, changed assets are invalidated and reported to the reload listeners.
+		 * From now on loose files are copied into memory instead of mapped, so views keep their content while a file is rewritten.
+		 * Assets mapped before keep their mapping, which shows changes in place and faults when read past a new end of the file.
+		 * @returns false if an archive is mounted (its assets shadow the loose files) or the watches could not be set up
+		 */
+		bool watch();
+
+		/* no listener is called anymore once this returns */
+		void stopWatching();
+
+		/**
+		 * Stops the I/O threads, queued loads fail and the jobs awaiting them are made ready again.
+		 * Called before the job scheduler terminates so those jobs can still run to their end, later loads fail right away.
+		 */
+		void stopLoading();
+
+		void addReloadListener(ReloadListener listener);
+
 		bool loadFile(const char* assetPath, std::vector<char>& fileContents);
 		bool loadTextFile(const char* assetPath, std::vector<char>& fileContents);
 		bool fileExists(const char* assetPath);
 
+		/** @returns true if both are loose files and assetPath was written after otherPath, archived assets never count as modified */
+		bool isModifiedAfter(const char* assetPath, const char* otherPath);
+
 	protected:
-		ENGINE_SUB_SYSTEM_CTOR(AssetManager) {}
+		ENGINE_SUB_SYSTEM_CTOR(AssetManager),
+			rootDir_(),
+			archive_(),
+			archivePath_(),
+			ioThreads_(),
+			ioMutex_(),
+			ioCv_(),
+			ioQueues_(),
+			isIoRunning_(false),
+			cacheMutex_(),
+			cache_(),
+			cacheLru_(),
+			cacheStats_(),
+			isRecordingPrefetch_(true),
+			isPrefetchManifestWritten_(false),
+			prefetchRecord_(),
+			prefetchRecordIndex_(),
+			prefetchManifestPath_(),
+			prefetchThread_(),
+			isPrefetching_(false),
+			openStreams_(0),
+			dependenciesMutex_(),
+			dependencies_(),
+			isWatching_(false),
+			watchThread_(),
+			watchFd_(-1),
+			watchWakeFd_(-1),
+			watchedDirs_(),
+			reloadMutex_(),
+			reloadListeners_()
+		{
+			cacheStats_.budget = ENGINE_ASSET_CACHE_BUDGET;
+		}
 
 		template<typename... Parts>
 		inline std::string createAbsolutePath(Parts... parts)
@@ -0,0 +1,84 @@
+#ifndef ENGINE_ASSET_STREAM_HPP
+#define ENGINE_ASSET_STREAM_HPP
+
+#include "framework.hpp"
+#include "AssetView.hpp"
+
+namespace NovaEngine
+{
+	class AssetManager;
+
+	/**
+	 * Sequential reader of AssetManager::openStream(), for assets too large to be loaded as a whole.
+	 * A reader thread fills a fixed pool of chunk buffers ahead of the consumer, so chunk N can be processed
+	 * while chunk N + 1 is read. Every chunk returns its buffer to the pool with its last view, the reader waits
+	 * for a free buffer, so memory stays at chunkSize * buffer count no matter how large the asset is.
+	 * Block compressed assets are streamed as stored, BlockCompression::decompressBlockAt() works on single blocks.
+	 */
+	class AssetStream
+	{
+	private:
+		struct Chunk
+		{
+			char* buffer;
+			size_t size;
+		};
+
+		/* shared with the reader thread and with the tokens of the returned chunks */
+		struct Pool
+		{
+			int fd = -1;
+			uint64_t offset = 0; // of the asset inside the file
+			uint64_t size = 0;
+			size_t chunkSize = 0;
+
+			std::vector<std::unique_ptr<char[]>> buffers;
+
+			std::mutex mutex;
+			std::condition_variable cv;
+			std::vector<char*> freeBuffers;
+			std::queue<Chunk> chunks; // read, not yet returned by next()
+			bool isDone = false;
+			bool isFailed = false;
+			bool isClosed = false;
+
+			~Pool();
+
+			void read();
+		};
+
+		std::shared_ptr<Pool> pool_;
+		std::thread reader_;
+		std::string path_;
+		std::atomic<size_t>* openStreams_; // of the AssetManager, released by close()
+
+		/* takes ownership of fd and of a slot already counted in openStreams */
+		void open(const char* path, int fd, uint64_t offset, uint64_t size, size_t chunkSize, size_t bufferCount, std::atomic<size_t>* openStreams);
+
+		friend class AssetManager;
+
+	public:
+		AssetStream() : pool_(), reader_(), path_(), openStreams_(nullptr) {}
+		~AssetStream() { close(); }
+
+		AssetStream(const AssetStream&) = delete;
+		AssetStream& operator=(const AssetStream&) = delete;
+
+		/**
+		 * Blocks until the next chunk is read, chunks are returned in order and all but the last one are chunkSize bytes.
+		 * @returns false once the whole asset was returned or a read failed (see isFailed())
+		 */
+		bool next(AssetView& chunk);
+
+		/* stops the reader and frees its slot for another stream, chunks that were already returned stay valid */
+		void close();
+
+		bool isFailed();
+
+		inline uint64_t size() const { return pool_ == nullptr ? 0 : pool_->size; }
+		inline const std::string& path() const { return path_; }
+		inline bool isOpen() const { return pool_ != nullptr; }
+	};
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef ENGINE_ASSET_VIEW_HPP
+#define ENGINE_ASSET_VIEW_HPP
+
+#include "framework.hpp"
+
+namespace NovaEngine
+{
+	/**
+	 * Read only view of asset bytes that does not own a copy of them.
+	 * The token keeps the underlying storage (e.g. a file mapping) alive, it is released together with the last view.
+	 */
+	class AssetView
+	{
+	private:
+		std::shared_ptr<const void> token_;
+		const char* data_;
+		size_t size_;
+
+	public:
+		AssetView() : token_(), data_(nullptr), size_(0) {}
+		AssetView(std::shared_ptr<const void> token, const char* data, size_t size) : token_(std::move(token)), data_(data), size_(size) {}
+
+		inline const char* data() const { return data_; }
+		inline size_t size() const { return size_; }
+		inline bool empty() const { return size_ == 0; }
+		inline explicit operator bool() const { return data_ != nullptr; }
+
+		inline std::span<const char> span() const { return std::span<const char>(data_, size_); }
+		inline std::string_view text() const { return std::string_view(data_, size_); }
+
+		/* shares the lifetime token of this view */
+		inline AssetView subview(size_t offset, size_t size) const
+		{
+			offset = std::min(offset, size_);
+			return AssetView(token_, data_ + offset, std::min(size, size_ - offset));
+		}
+
+		inline const std::shared_ptr<const void>& token() const { return token_; }
+	};
+};
+
+#endif
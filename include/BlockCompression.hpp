@@ -0,0 +1,344 @@
+#ifndef ENGINE_BLOCK_COMPRESSION_HPP
+#define ENGINE_BLOCK_COMPRESSION_HPP
+
+// shared with the tools, so this header only depends on the standard library
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+/**
+ * Compressed asset container, every block is compressed on its own so blocks can be decompressed in parallel.
+ *
+ *   Header
+ *   uint32_t blockSizes[blockCount]  compressed size of each block, storedFlag marks a block kept uncompressed
+ *   blocks                           back to back, block i decompresses to blockSize bytes (the last one to the rest)
+ *
+ * Blocks use a byte oriented LZ77 format: sequences of
+ *   token (literal length << 4 | match length - minMatch), [length extension], literals, uint16_t offset, [length extension]
+ * where a length of 15 is continued by bytes that are added up until one is below 255.
+ * The last sequence of a block only has literals.
+ */
+namespace NovaEngine::BlockCompression
+{
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t blockSize;
+		uint64_t rawSize;
+		uint32_t blockCount;
+		uint32_t reserved;
+	};
+
+	constexpr char fileMagic[8] = { 'N', 'O', 'V', 'A', 'L', 'Z', 'B', '\0' };
+	constexpr uint32_t fileVersion = 1;
+
+	/* offsets are 16 bit, blocks may not be larger than that */
+	constexpr uint32_t defaultBlockSize = 64 * 1024;
+	constexpr uint32_t storedFlag = 0x80000000u;
+
+	constexpr size_t minMatch = 4;
+	constexpr size_t lastLiterals = 5; // the end of a block is always literals
+	constexpr size_t matchSearchEnd = 12; // no match starts this close to the end of a block
+	constexpr size_t hashBits = 12;
+	constexpr size_t maxExpansion = 255; // raw bytes a single compressed byte can decode to at most
+
+	inline uint32_t read32(const char* data)
+	{
+		uint32_t value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	inline bool isCompressed(const char* data, size_t size)
+	{
+		return size >= sizeof(Header) && memcmp(data, fileMagic, sizeof(fileMagic)) == 0;
+	}
+
+	/** @returns the compressed size, 0 if the block did not get smaller than capacity */
+	inline size_t compressBlock(const char* in, size_t size, char* out, size_t capacity)
+	{
+		uint16_t table[1 << hashBits] = {};
+
+		const char* ip = in;
+		const char* anchor = in;
+		const char* end = in + size;
+		const char* searchEnd = size > matchSearchEnd ? end - matchSearchEnd : in;
+
+		char* op = out;
+		char* outEnd = out + capacity;
+
+		auto writeLength = [&](size_t length) {
+			for (; length >= 255; length -= 255)
+				*op++ = static_cast<char>(255);
+			*op++ = static_cast<char>(length);
+		};
+
+		auto writeSequence = [&](const char* literals, size_t literalLength, size_t offset, size_t matchLength, bool isLast) {
+			// token, both length extensions, literals and offset in the worst case
+			size_t worstCase = 1 + (literalLength / 255 + 1) + literalLength + 2 + (matchLength / 255 + 1);
+			if (static_cast<size_t>(outEnd - op) < worstCase)
+				return false;
+
+			size_t matchCode = isLast ? 0 : matchLength - minMatch;
+			*op++ = static_cast<char>((std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(matchCode, 15));
+
+			if (literalLength >= 15)
+				writeLength(literalLength - 15);
+
+			memcpy(op, literals, literalLength);
+			op += literalLength;
+
+			if (isLast)
+				return true;
+
+			*op++ = static_cast<char>(offset & 0xff);
+			*op++ = static_cast<char>(offset >> 8);
+
+			if (matchCode >= 15)
+				writeLength(matchCode - 15);
+
+			return true;
+		};
+
+		while (ip < searchEnd)
+		{
+			uint32_t sequence = read32(ip);
+			uint32_t hash = (sequence * 2654435761u) >> (32 - hashBits);
+
+			const char* match = in + table[hash];
+			table[hash] = static_cast<uint16_t>(ip - in);
+
+			if (match >= ip || ip - match > 0xffff || read32(match) != sequence)
+			{
+				ip++;
+				continue;
+			}
+
+			const char* matchEnd = ip + minMatch;
+			const char* reference = match + minMatch;
+			while (matchEnd < end - lastLiterals && *matchEnd == *reference)
+			{
+				matchEnd++;
+				reference++;
+			}
+
+			if (!writeSequence(anchor, ip - anchor, ip - match, matchEnd - ip, false))
+				return 0;
+
+			ip = matchEnd;
+			anchor = ip;
+		}
+
+		if (!writeSequence(anchor, end - anchor, 0, 0, true))
+			return 0;
+
+		return op - out;
+	}
+
+	/** @returns false if the block is corrupted or does not decompress to exactly outSize bytes */
+	inline bool decompressBlock(const char* in, size_t size, char* out, size_t outSize)
+	{
+		const char* ip = in;
+		const char* inEnd = in + size;
+		char* op = out;
+		char* outEnd = out + outSize;
+
+		auto readLength = [&](size_t* length) {
+			unsigned char byte;
+			do
+			{
+				if (ip >= inEnd)
+					return false;
+				byte = static_cast<unsigned char>(*ip++);
+				*length += byte;
+			} while (byte == 255);
+			return true;
+		};
+
+		while (ip < inEnd)
+		{
+			unsigned char token = static_cast<unsigned char>(*ip++);
+
+			size_t literalLength = token >> 4;
+			if (literalLength == 15 && !readLength(&literalLength))
+				return false;
+
+			if (literalLength > static_cast<size_t>(inEnd - ip) || literalLength > static_cast<size_t>(outEnd - op))
+				return false;
+
+			memcpy(op, ip, literalLength);
+			op += literalLength;
+			ip += literalLength;
+
+			if (ip == inEnd)
+				break;
+
+			if (inEnd - ip < 2)
+				return false;
+
+			size_t offset = static_cast<unsigned char>(ip[0]) | (static_cast<size_t>(static_cast<unsigned char>(ip[1])) << 8);
+			ip += 2;
+
+			size_t matchLength = token & 15;
+			if (matchLength == 15 && !readLength(&matchLength))
+				return false;
+			matchLength += minMatch;
+
+			if (offset == 0 || offset > static_cast<size_t>(op - out) || matchLength > static_cast<size_t>(outEnd - op))
+				return false;
+
+			const char* match = op - offset;
+			if (offset >= matchLength)
+			{
+				memcpy(op, match, matchLength);
+				op += matchLength;
+			}
+			else
+			{
+				// overlapping matches repeat the last offset bytes
+				for (size_t i = 0; i < matchLength; i++)
+					*op++ = match[i];
+			}
+		}
+
+		return op == outEnd;
+	}
+
+	/* appends the container for data to out, blocks that do not shrink are stored as they are */
+	inline void compress(const char* data, size_t size, std::string& out, uint32_t blockSize = defaultBlockSize)
+	{
+		Header header = {};
+		memcpy(header.magic, fileMagic, sizeof(header.magic));
+		header.version = fileVersion;
+		header.blockSize = blockSize;
+		header.rawSize = size;
+		header.blockCount = static_cast<uint32_t>((size + blockSize - 1) / blockSize);
+
+		out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		size_t tableOffset = out.size();
+		out.append(header.blockCount * sizeof(uint32_t), '\0');
+
+		std::string block(blockSize, '\0');
+
+		for (uint32_t i = 0; i < header.blockCount; i++)
+		{
+			size_t offset = static_cast<size_t>(i) * blockSize;
+			size_t length = std::min<size_t>(blockSize, size - offset);
+
+			// a block only stays compressed if that saves at least a byte
+			uint32_t blockLength = static_cast<uint32_t>(compressBlock(data + offset, length, block.data(), length - 1));
+			if (blockLength == 0)
+			{
+				blockLength = static_cast<uint32_t>(length) | storedFlag;
+				out.append(data + offset, length);
+			}
+			else
+			{
+				out.append(block.data(), blockLength);
+			}
+
+			memcpy(&out[tableOffset + i * sizeof(uint32_t)], &blockLength, sizeof(blockLength));
+		}
+	}
+
+	/** @returns false and leaves out untouched if compressing saves less than an eighth, smaller gains are not worth decompressing */
+	inline bool compressIfSmaller(const char* data, size_t size, std::string& out)
+	{
+		if (size == 0 || isCompressed(data, size))
+			return false;
+
+		std::string compressed;
+		compress(data, size, compressed);
+
+		if (compressed.size() >= size - size / 8)
+			return false;
+
+		out = std::move(compressed);
+		return true;
+	}
+
+	/**
+	 * Reads the header and the offset of every block (relative to data) from a container.
+	 * @returns false if it is not a container of this version, its blocks do not fit into size or can not add up to rawSize
+	 */
+	inline bool readLayout(const char* data, size_t size, Header& header, std::vector<uint64_t>& blockOffsets)
+	{
+		if (!isCompressed(data, size))
+			return false;
+
+		memcpy(&header, data, sizeof(header));
+		if (header.version != fileVersion || header.blockSize == 0 || header.blockSize > defaultBlockSize)
+			return false;
+
+		if (header.blockCount != (header.rawSize + header.blockSize - 1) / header.blockSize)
+			return false;
+
+		uint64_t offset = sizeof(Header) + static_cast<uint64_t>(header.blockCount) * sizeof(uint32_t);
+		if (offset > size)
+			return false;
+
+		blockOffsets.resize(header.blockCount + 1);
+
+		for (uint32_t i = 0; i < header.blockCount; i++)
+		{
+			uint32_t blockLength = read32(data + sizeof(Header) + i * sizeof(uint32_t));
+			uint64_t compressedSize = blockLength & ~storedFlag;
+			uint64_t rawSize = std::min<uint64_t>(header.blockSize, header.rawSize - static_cast<uint64_t>(i) * header.blockSize);
+
+			// no byte of a sequence decodes to more than 255 bytes, so a corrupted rawSize can not make the caller allocate
+			// more than the container could ever hold
+			if ((blockLength & storedFlag) ? compressedSize != rawSize : rawSize > compressedSize * maxExpansion)
+				return false;
+
+			blockOffsets[i] = offset;
+			offset += compressedSize;
+		}
+
+		blockOffsets[header.blockCount] = offset;
+		return offset <= size;
+	}
+
+	/** @returns false if the block is corrupted, out has to hold blockSize bytes (less for the last block) */
+	inline bool decompressBlockAt(const char* data, const Header& header, const std::vector<uint64_t>& blockOffsets, uint32_t index, char* out)
+	{
+		uint32_t blockLength = read32(data + sizeof(Header) + index * sizeof(uint32_t));
+		const char* block = data + blockOffsets[index];
+		size_t compressedSize = blockOffsets[index + 1] - blockOffsets[index];
+		size_t rawSize = std::min<uint64_t>(header.blockSize, header.rawSize - static_cast<uint64_t>(index) * header.blockSize);
+
+		if (blockLength & storedFlag)
+		{
+			if (compressedSize != rawSize)
+				return false;
+
+			memcpy(out, block, rawSize);
+			return true;
+		}
+
+		return decompressBlock(block, compressedSize, out, rawSize);
+	}
+
+	/** @returns false if data is not a valid container, decompresses all blocks on the calling thread */
+	inline bool decompress(const char* data, size_t size, std::string& out)
+	{
+		Header header;
+		std::vector<uint64_t> blockOffsets;
+		if (!readLayout(data, size, header, blockOffsets))
+			return false;
+
+		out.resize(header.rawSize);
+
+		for (uint32_t i = 0; i < header.blockCount; i++)
+			if (!decompressBlockAt(data, header, blockOffsets, i, out.data() + static_cast<size_t>(i) * header.blockSize))
+				return false;
+
+		return true;
+	}
+};
+
+#endif
@@ -2,6 +2,7 @@
 #define ENGINE_ENGINE_CONFIG_HPP
 
 #include "framework.hpp"
+#include "LogFormat.hpp"
 
 namespace NovaEngine
 {
@@ -19,10 +20,31 @@ namespace NovaEngine
 		bool hidden;
 	};
 
+	struct JobsConfig
+	{
+		size_t minWorkers;
+		size_t maxWorkers; // 0 uses one worker per hardware thread besides the main thread
+	};
+
+	struct AssetsConfig
+	{
+		size_t cacheBudget; // bytes of unused assets kept loaded
+		bool hotReload; // watch the loose assets and reload changed scripts
+		bool recordPrefetch; // write the asset requests of this run into the prefetch manifest of the next one
+	};
+
+	struct LogConfig
+	{
+		LogFormat::Severity severities[static_cast<size_t>(LogFormat::Category::COUNT)]; // lowest severity logged per category
+	};
+
 	struct EngineConfig
 	{
 		std::string name;
 		GameWindowConfig window;
+		JobsConfig jobs;
+		AssetsConfig assets;
+		LogConfig log;
 	};
 };
 
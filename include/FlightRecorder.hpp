@@ -0,0 +1,82 @@
+#ifndef ENGINE_FLIGHT_RECORDER_HPP
+#define ENGINE_FLIGHT_RECORDER_HPP
+
+#include "framework.hpp"
+#include "LogFormat.hpp"
+
+#ifndef ENGINE_FLIGHT_RECORDER_SLOTS
+#define ENGINE_FLIGHT_RECORDER_SLOTS 4096
+#endif
+
+#ifndef ENGINE_FLIGHT_RECORDER_SLOT_SIZE
+#define ENGINE_FLIGHT_RECORDER_SLOT_SIZE 128
+#endif
+
+namespace NovaEngine
+{
+	/**
+	 * Always on in memory ring of the latest log records, scheduler events and frame markers.
+	 * Slots are overwritten in order and never allocate, a crash signal dumps them as a binary log
+	 * (readable with tools/log-decoder) using only async-signal-safe calls.
+	 */
+	class FlightRecorder
+	{
+	private:
+		struct Slot
+		{
+			std::atomic<uint64_t> sequence; // 0 while being written, index + 1 once complete
+			char data[ENGINE_FLIGHT_RECORDER_SLOT_SIZE - sizeof(std::atomic<uint64_t>)];
+		};
+
+		static_assert((ENGINE_FLIGHT_RECORDER_SLOTS & (ENGINE_FLIGHT_RECORDER_SLOTS - 1)) == 0, "ENGINE_FLIGHT_RECORDER_SLOTS has to be a power of two");
+
+		static Slot slots_[ENGINE_FLIGHT_RECORDER_SLOTS];
+		static std::atomic<uint64_t> next_;
+
+		/* formatted when installing, the signal handler can not build strings */
+		static char dumpPath_[PATH_MAX];
+		static std::atomic<bool> isDumping_;
+
+		static void onSignal(int signal, siginfo_t* info, void* context);
+
+		static inline Slot& beginSlot(uint64_t* index)
+		{
+			*index = next_.fetch_add(1, std::memory_order::relaxed);
+			Slot& slot = slots_[*index & (ENGINE_FLIGHT_RECORDER_SLOTS - 1)];
+			slot.sequence.store(0, std::memory_order::relaxed);
+			std::atomic_thread_fence(std::memory_order::release);
+			return slot;
+		}
+
+	public:
+		static constexpr size_t maxArgsSize = sizeof(Slot::data) - sizeof(LogFormat::RecordHeader);
+
+		/** @returns false if the crash handlers could not be installed, the recorder keeps recording either way */
+		static bool install(const char* dumpPath);
+
+		/* writes every complete slot from oldest to newest, async-signal-safe */
+		static void dump(int fd);
+
+		/* long string arguments are shortened to fit a slot */
+		template<typename... Ts>
+		static void record(uint32_t formatId, LogFormat::Category category, LogFormat::Severity severity, const Ts&... args)
+		{
+			uint64_t index;
+			Slot& slot = beginSlot(&index);
+
+			LogFormat::RecordHeader header = {};
+			header.formatId = formatId;
+			header.argsSize = static_cast<uint32_t>(LogFormat::encodedSize(maxArgsSize, args...));
+			header.timestamp = LogFormat::now();
+			header.severity = severity;
+			header.category = category;
+
+			memcpy(slot.data, &header, sizeof(header));
+			LogFormat::encode(slot.data + sizeof(header), header.argsSize, args...);
+
+			slot.sequence.store(index + 1, std::memory_order::release);
+		}
+	};
+};
+
+#endif
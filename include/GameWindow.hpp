@@ -29,6 +29,12 @@ namespace NovaEngine
 
 		void show();
 
+		/**
+		 * @returns the refresh rate in Hz of the monitor the window is shown on (the primary one when windowed),
+		 * as read on the main thread when the window was created or shown, so jobs can call it from any worker
+		 */
+		int refreshRate() { return refreshRate_.load(std::memory_order::relaxed); }
+
 		void destroy();
 
 		GLFWwindow* glfwWindow();
@@ -36,6 +42,10 @@ namespace NovaEngine
 	private:
 		Engine* engine_;
 		GLFWwindow* window_;
+		std::atomic<int> refreshRate_;
+
+		/* queries the monitor, GLFW only allows that on the main thread */
+		void updateRefreshRate();
 
 		friend class Engine;
 	};
@@ -0,0 +1,168 @@
+#ifndef ENGINE_LOCK_PROFILER_HPP
+#define ENGINE_LOCK_PROFILER_HPP
+
+#include "framework.hpp"
+
+#include <source_location>
+
+/*
+ * Lock statistics cost atomic read-modify-writes on shared counters for every acquire, including the scheduler queues,
+ * so they are only recorded in builds that define ENGINE_LOCK_PROFILING.
+ */
+
+namespace NovaEngine
+{
+	class LockProfiler;
+
+	/* acquire statistics of a single lock, registered with the LockProfiler for its whole lifetime */
+	class LockStats
+	{
+	public:
+		/* bucket i counts waits between 2^i and 2^(i+1) nanoseconds */
+		static constexpr size_t histogramBuckets = 32;
+		static constexpr size_t maxSites = 16;
+		/* waits of locks that can't be try_lock'ed count as contended above this */
+		static constexpr uint64_t contendedWaitNs = 1000;
+
+		struct Site
+		{
+			std::atomic<uint64_t> key; // claims the slot
+			std::atomic<const char*> file; // published last, the site is only reported once it is set
+			const char* function;
+			uint32_t line;
+			std::atomic<size_t> acquires;
+			std::atomic<size_t> contended;
+			std::atomic<uint64_t> waitNs;
+		};
+
+		LockStats(const char* name);
+		~LockStats();
+
+		LockStats(const LockStats&) = delete;
+		LockStats& operator=(const LockStats&) = delete;
+
+		inline void record(const std::source_location& location, bool contended, uint64_t waitNs)
+		{
+#ifdef ENGINE_LOCK_PROFILING
+			recordAcquire(location, contended, waitNs);
+#endif
+		}
+
+		const char* name() const { return name_; }
+
+	private:
+		Site* findSite(const std::source_location& location);
+		void recordAcquire(const std::source_location& location, bool contended, uint64_t waitNs);
+
+		const char* name_;
+		std::atomic<size_t> acquires_;
+		std::atomic<size_t> contended_;
+		std::atomic<uint64_t> waitNs_;
+		std::atomic<uint64_t> maxWaitNs_;
+		std::atomic<size_t> histogram_[histogramBuckets];
+		Site sites_[maxSites];
+
+		friend class LockProfiler;
+	};
+
+	/* std::mutex replacement that records who acquires it and how long they had to wait */
+	class InstrumentedMutex
+	{
+	private:
+		std::mutex mutex_;
+		LockStats stats_;
+
+	public:
+		InstrumentedMutex(const char* name = "mutex") : mutex_(), stats_(name) {}
+
+		void lock(const std::source_location& location = std::source_location::current())
+		{
+#ifdef ENGINE_LOCK_PROFILING
+			if (mutex_.try_lock())
+			{
+				stats_.record(location, false, 0);
+				return;
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			mutex_.lock();
+			uint64_t waitNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+			stats_.record(location, true, waitNs);
+#else
+			mutex_.lock();
+#endif
+		}
+
+		bool try_lock(const std::source_location& location = std::source_location::current())
+		{
+			if (!mutex_.try_lock())
+				return false;
+
+			stats_.record(location, false, 0);
+			return true;
+		}
+
+		void unlock() { mutex_.unlock(); }
+
+		LockStats& stats() { return stats_; }
+	};
+
+	/**
+	 * Scoped lock for an InstrumentedMutex that keeps the call site of its creation,
+	 * so re-locking (e.g. inside std::condition_variable_any::wait) is attributed correctly.
+	 */
+	class InstrumentedLock
+	{
+	private:
+		InstrumentedMutex& mutex_;
+		std::source_location location_;
+		bool isLocked_;
+
+	public:
+		InstrumentedLock(InstrumentedMutex& mutex, const std::source_location& location = std::source_location::current()) :
+			mutex_(mutex),
+			location_(location),
+			isLocked_(false)
+		{
+			lock();
+		}
+
+		~InstrumentedLock()
+		{
+			if (isLocked_)
+				unlock();
+		}
+
+		InstrumentedLock(const InstrumentedLock&) = delete;
+		InstrumentedLock& operator=(const InstrumentedLock&) = delete;
+
+		void lock()
+		{
+			mutex_.lock(location_);
+			isLocked_ = true;
+		}
+
+		void unlock()
+		{
+			isLocked_ = false;
+			mutex_.unlock();
+		}
+
+		bool ownsLock() const { return isLocked_; }
+	};
+
+	class LockProfiler
+	{
+	public:
+		/* logs the statistics of every lock that was acquired at least once */
+		static void logReport();
+
+	private:
+		static std::mutex& registryMutex();
+		static std::vector<LockStats*>& registry();
+
+		friend class LockStats;
+	};
+};
+
+#endif
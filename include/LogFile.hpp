@@ -0,0 +1,70 @@
+#ifndef ENGINE_LOG_FILE_HPP
+#define ENGINE_LOG_FILE_HPP
+
+#include "framework.hpp"
+
+#ifndef ENGINE_LOG_SEGMENT_SIZE
+#define ENGINE_LOG_SEGMENT_SIZE (8 * 1024 * 1024)
+#endif
+
+#ifndef ENGINE_LOG_SEGMENT_COUNT
+#define ENGINE_LOG_SEGMENT_COUNT 8
+#endif
+
+namespace NovaEngine
+{
+	/**
+	 * Log output split into preallocated, memory mapped segment files <name>-<sequence><extension>.
+	 * Only the newest segmentCount segments are kept, <name>.index holds the latest sequence
+	 * so opening a log never has to scan the directory.
+	 */
+	class LogFile
+	{
+	private:
+		std::string directory_;
+		std::string name_;
+		std::string extension_;
+		size_t segmentSize_;
+		size_t segmentCount_;
+
+		uint64_t sequence_;
+		int fd_;
+		char* mapping_;
+		size_t offset_;
+
+		std::string segmentPath(uint64_t sequence);
+		std::string indexPath();
+
+		uint64_t readIndex();
+		void writeIndex();
+
+		bool openSegment();
+		void closeSegment();
+
+	public:
+		LogFile();
+		~LogFile();
+
+		LogFile(const LogFile&) = delete;
+		LogFile& operator=(const LogFile&) = delete;
+
+		/** @returns false if the first segment could not be created */
+		bool open(const std::string& directory, const std::string& name, const char* extension, size_t segmentSize, size_t segmentCount);
+
+		/* unmaps the current segment and cuts it to the written size */
+		void close();
+
+		/** @returns false if the next segment could not be created, nothing is written until a later rotate() creates it */
+		bool rotate();
+
+		/* size has to fit into remaining(), rotate first otherwise */
+		void write(const char* data, size_t size);
+
+		inline bool isOpen() const { return mapping_ != nullptr; }
+		inline size_t remaining() const { return mapping_ == nullptr ? 0 : segmentSize_ - offset_; }
+		inline size_t segmentSize() const { return segmentSize_; }
+		inline uint64_t sequence() const { return sequence_; }
+	};
+};
+
+#endif
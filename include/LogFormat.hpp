@@ -0,0 +1,380 @@
+#ifndef ENGINE_LOG_FORMAT_HPP
+#define ENGINE_LOG_FORMAT_HPP
+
+// shared with the tools, so this header only depends on the standard library
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <algorithm>
+#include <cctype>
+
+/**
+ * Binary representation of log records.
+ * A log call only encodes its raw arguments, the text is produced later by the log handler thread or by tools/log-decoder.
+ *
+ * Binary log file layout:
+ *   FileHeader
+ *   { uint32_t tag = formatTag,  uint32_t formatId, uint32_t argCount, ArgType[argCount] }  once per format before its first record
+ *   { uint32_t tag = recordTag,  RecordHeader, encoded arguments }
+ */
+namespace NovaEngine::LogFormat
+{
+	/* ordered from most to least verbose, filters let everything at or above a severity through */
+	enum class Severity : uint8_t
+	{
+		VERBOSE,
+		INFO,
+		WARNING,
+		ERROR,
+		DEFAULT = INFO,
+	};
+
+	enum class Category : uint8_t
+	{
+		GENERAL,
+		JOBS,
+		GRAPHICS,
+		SCRIPT,
+		ASSET,
+		COUNT,
+	};
+
+	enum class ArgType : uint8_t
+	{
+		STRING, // uint32_t length + bytes
+		INT,    // int64_t
+		UINT,   // uint64_t
+		FLOAT,  // double
+		BOOL,   // uint8_t
+		CHAR,   // char
+	};
+
+	struct FileHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t reserved;
+	};
+
+	struct RecordHeader
+	{
+		uint32_t formatId;
+		uint32_t argsSize;
+		int64_t timestamp; // nanoseconds since the unix epoch
+		Severity severity;
+		Category category;
+		uint8_t reserved[2];
+		uint32_t repeated; // identical records from the same call site folded into this one
+		uint32_t dropped;  // records of the same call site dropped by its rate limit before this one
+		uint32_t reserved2;
+	};
+
+	constexpr char fileMagic[8] = { 'N', 'O', 'V', 'A', 'L', 'O', 'G', '\0' };
+	constexpr uint32_t fileVersion = 3;
+	constexpr uint32_t formatTag = 0x544d4f46; // "FOMT"
+	constexpr uint32_t recordTag = 0x44434552; // "RECD"
+	constexpr uint32_t invalidFormat = UINT32_MAX;
+
+	inline const char* severityName(Severity severity)
+	{
+		switch (severity)
+		{
+		case Severity::VERBOSE:
+			return "VERBOSE";
+		case Severity::WARNING:
+			return "WARN";
+		case Severity::ERROR:
+			return "ERROR";
+		case Severity::INFO:
+		default:
+			return "INFO";
+		}
+	}
+
+	inline const char* categoryName(Category category)
+	{
+		switch (category)
+		{
+		case Category::JOBS:
+			return "JOBS";
+		case Category::GRAPHICS:
+			return "GRAPHICS";
+		case Category::SCRIPT:
+			return "SCRIPT";
+		case Category::ASSET:
+			return "ASSET";
+		case Category::GENERAL:
+		default:
+			return "GENERAL";
+		}
+	}
+
+	inline bool equalsIgnoreCase(std::string_view a, std::string_view b)
+	{
+		return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+			return tolower(static_cast<unsigned char>(x)) == tolower(static_cast<unsigned char>(y));
+		});
+	}
+
+	/** @returns false if name is not a severity, "warning" is accepted besides the short names */
+	inline bool parseSeverity(std::string_view name, Severity* severity)
+	{
+		for (Severity candidate : { Severity::VERBOSE, Severity::INFO, Severity::WARNING, Severity::ERROR })
+		{
+			if (equalsIgnoreCase(name, severityName(candidate)))
+			{
+				*severity = candidate;
+				return true;
+			}
+		}
+
+		if (equalsIgnoreCase(name, "warning"))
+		{
+			*severity = Severity::WARNING;
+			return true;
+		}
+
+		return false;
+	}
+
+	/** @returns false if name is not a category */
+	inline bool parseCategory(std::string_view name, Category* category)
+	{
+		for (size_t i = 0; i < static_cast<size_t>(Category::COUNT); i++)
+		{
+			if (equalsIgnoreCase(name, categoryName(static_cast<Category>(i))))
+			{
+				*category = static_cast<Category>(i);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	inline int64_t now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+
+#pragma region encoding
+
+	template<typename T>
+	constexpr bool unsupportedArg = false;
+
+	template<typename T>
+	constexpr ArgType argTypeOf()
+	{
+		typedef std::decay_t<T> Arg;
+
+		if constexpr (std::is_same_v<Arg, bool>)
+			return ArgType::BOOL;
+		else if constexpr (std::is_same_v<Arg, char>)
+			return ArgType::CHAR;
+		else if constexpr (std::is_integral_v<Arg> && std::is_signed_v<Arg>)
+			return ArgType::INT;
+		else if constexpr (std::is_integral_v<Arg>)
+			return ArgType::UINT;
+		else if constexpr (std::is_floating_point_v<Arg>)
+			return ArgType::FLOAT;
+		else if constexpr (std::is_convertible_v<const Arg&, std::string_view>)
+			return ArgType::STRING;
+		else
+			static_assert(unsupportedArg<T>, "unsupported log argument type");
+	}
+
+	constexpr size_t fixedSize(ArgType type)
+	{
+		switch (type)
+		{
+		case ArgType::STRING:
+			return sizeof(uint32_t);
+		case ArgType::BOOL:
+		case ArgType::CHAR:
+			return 1;
+		default:
+			return 8;
+		}
+	}
+
+	inline std::string_view stringOf(const char* str) { return str == nullptr ? std::string_view("(null)") : std::string_view(str); }
+	inline std::string_view stringOf(std::string_view str) { return str; }
+
+	template<typename T>
+	size_t stringLength(const T& arg)
+	{
+		if constexpr (argTypeOf<T>() == ArgType::STRING)
+			return stringOf(arg).size();
+		else
+			return 0;
+	}
+
+	/** @returns the encoded size of the arguments, strings get shortened so that it never exceeds maxSize */
+	template<typename... Ts>
+	size_t encodedSize(size_t maxSize, const Ts&... args)
+	{
+		size_t fixed = (fixedSize(argTypeOf<Ts>()) + ... + 0);
+		size_t strings = (stringLength(args) + ... + 0);
+		return std::min(fixed + strings, std::max(maxSize, fixed));
+	}
+
+	template<typename T>
+	void encodeArg(char*& out, size_t& stringBudget, const T& arg)
+	{
+		constexpr ArgType type = argTypeOf<T>();
+
+		if constexpr (type == ArgType::STRING)
+		{
+			std::string_view str = stringOf(arg);
+			uint32_t length = static_cast<uint32_t>(std::min(str.size(), stringBudget));
+			memcpy(out, &length, sizeof(length));
+			memcpy(out + sizeof(length), str.data(), length);
+			out += sizeof(length) + length;
+			stringBudget -= length;
+		}
+		else if constexpr (type == ArgType::INT)
+		{
+			int64_t value = static_cast<int64_t>(arg);
+			memcpy(out, &value, sizeof(value));
+			out += sizeof(value);
+		}
+		else if constexpr (type == ArgType::UINT)
+		{
+			uint64_t value = static_cast<uint64_t>(arg);
+			memcpy(out, &value, sizeof(value));
+			out += sizeof(value);
+		}
+		else if constexpr (type == ArgType::FLOAT)
+		{
+			double value = static_cast<double>(arg);
+			memcpy(out, &value, sizeof(value));
+			out += sizeof(value);
+		}
+		else
+		{
+			*out++ = static_cast<char>(arg);
+		}
+	}
+
+	/* size has to come from encodedSize() with the same arguments */
+	template<typename... Ts>
+	void encode(char* out, size_t size, const Ts&... args)
+	{
+		size_t stringBudget = size - (fixedSize(argTypeOf<Ts>()) + ... + 0);
+		(encodeArg(out, stringBudget, args), ...);
+	}
+
+#pragma endregion
+
+#pragma region decoding
+
+	/** @returns false if the encoded data does not match the argument types */
+	inline bool appendArgs(std::string& out, const ArgType* types, size_t count, const char* data, size_t size)
+	{
+		const char* end = data + size;
+		char number[32];
+
+		for (size_t i = 0; i < count; i++)
+		{
+			if (static_cast<size_t>(end - data) < fixedSize(types[i]))
+				return false;
+
+			switch (types[i])
+			{
+			case ArgType::STRING:
+			{
+				uint32_t length;
+				memcpy(&length, data, sizeof(length));
+				data += sizeof(length);
+				if (static_cast<size_t>(end - data) < length)
+					return false;
+				out.append(data, length);
+				data += length;
+				break;
+			}
+			case ArgType::INT:
+			{
+				int64_t value;
+				memcpy(&value, data, sizeof(value));
+				out.append(number, snprintf(number, sizeof(number), "%lld", static_cast<long long>(value)));
+				data += sizeof(value);
+				break;
+			}
+			case ArgType::UINT:
+			{
+				uint64_t value;
+				memcpy(&value, data, sizeof(value));
+				out.append(number, snprintf(number, sizeof(number), "%llu", static_cast<unsigned long long>(value)));
+				data += sizeof(value);
+				break;
+			}
+			case ArgType::FLOAT:
+			{
+				double value;
+				memcpy(&value, data, sizeof(value));
+				out.append(number, snprintf(number, sizeof(number), "%g", value));
+				data += sizeof(value);
+				break;
+			}
+			case ArgType::BOOL:
+				out += *data++ ? "true" : "false";
+				break;
+			case ArgType::CHAR:
+				out += *data++;
+				break;
+			default:
+				return false;
+			}
+		}
+
+		return data == end;
+	}
+
+	/* appends "[HH:MM:SS] " for the record time stamp */
+	inline void appendTime(std::string& out, int64_t timestamp)
+	{
+		time_t seconds = static_cast<time_t>(timestamp / 1000000000);
+		struct tm timeInfo;
+		localtime_r(&seconds, &timeInfo);
+
+		char buffer[16];
+		out.append(buffer, strftime(buffer, sizeof(buffer), "[%T] ", &timeInfo));
+	}
+
+	/* appends one complete text line for a record */
+	inline void appendLine(std::string& out, const RecordHeader& header, const ArgType* types, size_t count, const char* args)
+	{
+		appendTime(out, header.timestamp);
+		out += '[';
+		out += severityName(header.severity);
+		out += "] ";
+
+		if (header.category != Category::GENERAL)
+		{
+			out += '[';
+			out += categoryName(header.category);
+			out += "] ";
+		}
+
+		if (types == nullptr || !appendArgs(out, types, count, args, header.argsSize))
+			out += "<malformed record for format " + std::to_string(header.formatId) + ">";
+
+		if (header.repeated > 0)
+			out += " (repeated " + std::to_string(header.repeated) + " times)";
+
+		if (header.dropped > 0)
+			out += " (" + std::to_string(header.dropped) + " lines dropped)";
+
+		out += '\n';
+	}
+
+#pragma endregion
+}
+
+#endif
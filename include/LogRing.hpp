@@ -0,0 +1,154 @@
+#ifndef ENGINE_LOG_RING_HPP
+#define ENGINE_LOG_RING_HPP
+
+#include "framework.hpp"
+
+#ifndef ENGINE_LOG_RING_SIZE
+#define ENGINE_LOG_RING_SIZE (64 * 1024)
+#endif
+
+namespace NovaEngine
+{
+	/**
+	 * Single producer / single consumer ring of variable sized records.
+	 * A record is never split at the end of the buffer, so both sides always see it as one contiguous block.
+	 * The consumer may read several records before releasing them all at once.
+	 */
+	class LogRing
+	{
+	private:
+		struct RecordHeader
+		{
+			uint32_t size; // payload size, skipMarker pads the end of the buffer before a wrap
+			uint32_t flags;
+		};
+
+		static constexpr size_t capacity_ = ENGINE_LOG_RING_SIZE;
+		static constexpr uint32_t skipMarker_ = std::numeric_limits<uint32_t>::max();
+
+		static_assert((capacity_ & (capacity_ - 1)) == 0, "ENGINE_LOG_RING_SIZE has to be a power of two");
+
+		static constexpr size_t recordSize(size_t payloadSize)
+		{
+			return (sizeof(RecordHeader) + payloadSize + 7) & ~static_cast<size_t>(7);
+		}
+
+		std::unique_ptr<char[]> buffer_;
+		alignas(64) std::atomic<size_t> head_;
+		size_t pendingHead_;
+		size_t pendingStart_;
+		RecordHeader* pendingRecord_;
+		alignas(64) std::atomic<size_t> tail_;
+		size_t readCursor_;
+
+	public:
+		/* biggest payload a single record can hold */
+		static constexpr size_t maxPayloadSize = capacity_ / 4;
+
+		LogRing() : buffer_(new char[capacity_]), head_(0), pendingHead_(0), pendingStart_(0), pendingRecord_(nullptr), tail_(0), readCursor_(0) {}
+
+		LogRing(const LogRing&) = delete;
+		LogRing& operator=(const LogRing&) = delete;
+
+#pragma region producer
+
+		/** @returns space for a payload of the given size or nullptr if the ring is too full, publish it with commit() */
+		char* reserve(size_t size, uint32_t flags)
+		{
+			size_t head = head_.load(std::memory_order::relaxed);
+			size_t used = head - tail_.load(std::memory_order::acquire);
+			size_t position = head & (capacity_ - 1);
+			size_t toEnd = capacity_ - position;
+			size_t needed = recordSize(size);
+
+			if (needed > toEnd)
+			{
+				if (used + toEnd + needed > capacity_)
+					return nullptr;
+
+				reinterpret_cast<RecordHeader*>(&buffer_[position])->size = skipMarker_;
+				head += toEnd;
+				position = 0;
+			}
+			else if (used + needed > capacity_)
+			{
+				return nullptr;
+			}
+
+			RecordHeader* header = reinterpret_cast<RecordHeader*>(&buffer_[position]);
+			header->size = static_cast<uint32_t>(size);
+			header->flags = flags;
+
+			pendingStart_ = head;
+			pendingRecord_ = header;
+			pendingHead_ = head + needed;
+			return reinterpret_cast<char*>(header + 1);
+		}
+
+		void commit()
+		{
+			head_.store(pendingHead_, std::memory_order::release);
+		}
+
+		/* publishes the reserved record cut down to size, for payloads whose final size is only known after writing */
+		void commit(size_t size)
+		{
+			pendingRecord_->size = static_cast<uint32_t>(size);
+			pendingHead_ = pendingStart_ + recordSize(size);
+			commit();
+		}
+
+		size_t usedBytes()
+		{
+			return head_.load(std::memory_order::relaxed) - tail_.load(std::memory_order::relaxed);
+		}
+
+		static constexpr size_t capacity() { return capacity_; }
+
+#pragma endregion
+
+#pragma region consumer
+
+		/** @returns false if there is no unread record left */
+		bool front(const char** payload, uint32_t* size, uint32_t* flags)
+		{
+			size_t head = head_.load(std::memory_order::acquire);
+
+			while (readCursor_ != head)
+			{
+				size_t position = readCursor_ & (capacity_ - 1);
+				const RecordHeader* header = reinterpret_cast<const RecordHeader*>(&buffer_[position]);
+
+				if (header->size == skipMarker_)
+				{
+					readCursor_ += capacity_ - position;
+					continue;
+				}
+
+				*payload = reinterpret_cast<const char*>(header + 1);
+				*size = header->size;
+				*flags = header->flags;
+				return true;
+			}
+
+			return false;
+		}
+
+		/* moves past the record returned by front() */
+		void next()
+		{
+			const RecordHeader* header = reinterpret_cast<const RecordHeader*>(&buffer_[readCursor_ & (capacity_ - 1)]);
+			readCursor_ += recordSize(header->size);
+		}
+
+		/* hands everything read so far back to the producer, pointers returned by front() become invalid */
+		void release()
+		{
+			tail_.store(readCursor_, std::memory_order::release);
+		}
+
+#pragma endregion
+	};
+};
+
+#endif
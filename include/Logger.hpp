@@ -2,184 +2,337 @@
 #define ENGINE_LOGGER_HPP
 
 #include "framework.hpp"
+#include "LockProfiler.hpp"
+#include "LogRing.hpp"
+#include "LogFormat.hpp"
+#include "LogFile.hpp"
+#include "FlightRecorder.hpp"
+
+#ifndef ENGINE_LOG_MAX_FORMATS
+#define ENGINE_LOG_MAX_FORMATS 1024
+#endif
+
+// identical messages of a call site within this window are folded into one line
+#ifndef ENGINE_LOG_DEDUP_WINDOW_MS
+#define ENGINE_LOG_DEDUP_WINDOW_MS 1000
+#endif
+
+// token bucket per call site: lines per second and the burst it may save up
+#ifndef ENGINE_LOG_SITE_RATE
+#define ENGINE_LOG_SITE_RATE 20
+#endif
+
+#ifndef ENGINE_LOG_SITE_BURST
+#define ENGINE_LOG_SITE_BURST 50
+#endif
+
+// messages with longer arguments are never folded
+#ifndef ENGINE_LOG_SITE_BUFFER
+#define ENGINE_LOG_SITE_BUFFER 256
+#endif
+
+// severities below this are compiled out of the ENGINE_LOG_* macros
+#ifndef ENGINE_LOG_MIN_SEVERITY
+#ifdef DEBUG
+#define ENGINE_LOG_MIN_SEVERITY VERBOSE
+#else
+#define ENGINE_LOG_MIN_SEVERITY INFO
+#endif
+#endif
+
+// arguments are only evaluated if the severity is compiled in and enabled for the category at runtime,
+// each use of the macro is a call site with its own repeat folding and rate limit
+#define ENGINE_LOG(category, severity, ...) \
+	do \
+	{ \
+		if constexpr (NovaEngine::LogFormat::Severity::severity >= NovaEngine::Logger::minSeverity) \
+		{ \
+			if (NovaEngine::Logger::isEnabled(NovaEngine::LogFormat::Category::category, NovaEngine::LogFormat::Severity::severity)) \
+			{ \
+				static NovaEngine::Logger::Site logSite; \
+				NovaEngine::Logger::get()->log(logSite, NovaEngine::LogFormat::Category::category, NovaEngine::LogFormat::Severity::severity, __VA_ARGS__); \
+			} \
+		} \
+	} while (false)
+
+/* handle to a named logger, the registry is only consulted the first time this line runs */
+#define ENGINE_LOGGER(name) ([]() -> NovaEngine::Logger* { static NovaEngine::Logger* logger = NovaEngine::Logger::get(name); return logger; }())
+
+/* puts an event only into the flight recorder, cheap enough for every frame */
+#define ENGINE_FLIGHT_EVENT(category, ...) NovaEngine::Logger::recordEvent(NovaEngine::LogFormat::Category::category, __VA_ARGS__)
+
+#define ENGINE_LOG_VERBOSE(category, ...) ENGINE_LOG(category, VERBOSE, __VA_ARGS__)
+#define ENGINE_LOG_INFO(category, ...) ENGINE_LOG(category, INFO, __VA_ARGS__)
+#define ENGINE_LOG_WARN(category, ...) ENGINE_LOG(category, WARNING, __VA_ARGS__)
+#define ENGINE_LOG_ERROR(category, ...) ENGINE_LOG(category, ERROR, __VA_ARGS__)
 
 namespace NovaEngine
 {
 	class Logger
 	{
+		friend class FlightRecorder;
+
+	public:
+		typedef LogFormat::Severity Severity;
+		typedef LogFormat::Category Category;
+
+		static constexpr Severity minSeverity = Severity::ENGINE_LOG_MIN_SEVERITY;
+
+		/**
+		 * State of one logging call site, see ENGINE_LOG.
+		 * Remembers the last message to fold repeats of it and limits the site with a token bucket.
+		 */
+		struct Site
+		{
+			std::atomic<bool> isLocked = false;
+			std::atomic<bool> isRegistered = false;
+			Site* next = nullptr;
+
+			uint64_t hash = 0;
+			int64_t windowStart = 0;
+			uint32_t repeated = 0;
+			uint32_t dropped = 0;
+
+			double tokens = ENGINE_LOG_SITE_BURST;
+			int64_t lastRefill = 0;
+
+			Logger* logger = nullptr;
+			uint32_t formatId = LogFormat::invalidFormat;
+			Category category = Category::GENERAL;
+			Severity severity = Severity::INFO;
+			size_t lastSize = 0;
+			char last[ENGINE_LOG_SITE_BUFFER];
+		};
+
 	private:
-		struct LogInfo
+		struct Format
 		{
-			bool isNewLine = false;
-			Logger* logger;
-			std::string data;
+			const LogFormat::ArgType* types;
+			size_t argCount;
 		};
 
 		static std::optional<std::thread> logHandlerThread_;
-		static std::mutex mutex_;
-		static std::condition_variable cv_;
+		static InstrumentedMutex mutex_;
+		static std::condition_variable_any cv_;
 
+		/* loggers are registered once and never freed, so handles can be cached */
 		static std::unordered_map<std::string, Logger*> loggers_;
-		static std::queue<LogInfo> logQueue_;
+		static std::mutex registryMutex_;
+		static std::atomic<Logger*> defaultLogger_;
+
+		/* one ring per logging thread, only the log handler thread reads from them, never freed */
+		static std::vector<LogRing*>& rings();
+		static thread_local LogRing* threadRing_;
+
+		/* set on the log handler thread, which must not wait for room in its own ring */
+		static thread_local bool isLogHandler_;
+
+		/* format ids index into formats_, an id is published before the first record using it */
+		static Format formats_[ENGINE_LOG_MAX_FORMATS];
+		static std::atomic<uint32_t> formatCount_;
+
+		static std::atomic<bool> shouldTerminate_;
+		static bool binaryOutput_;
+		static size_t segmentSize_;
+		static size_t segmentCount_;
 
-		static bool shouldTerminate_;
+		static std::atomic<Severity> severities_[static_cast<size_t>(Category::COUNT)];
 
-		static std::string& date();
+		/* every site that logged at least once, so pending repeats get written once their window ends */
+		static std::atomic<Site*> sites_;
+
+		static constexpr size_t maxArgsSize = LogRing::maxPayloadSize - sizeof(Logger*) - sizeof(LogFormat::RecordHeader);
+
+		static Logger* create(const std::string& name);
+
+		static LogRing* threadRing();
+		static void handleLogs();
+		static void drainRing(LogRing* ring, std::string& text, std::string& console);
+
+		static uint32_t registerFormat(const LogFormat::ArgType* types, size_t argCount);
+
+		/** @returns the format id for this argument type signature, registered on first use */
+		template<LogFormat::ArgType... types>
+		static uint32_t formatId()
+		{
+			static constexpr LogFormat::ArgType signature[] = { types... };
+			static const uint32_t id = registerFormat(signature, sizeof...(types));
+			return id;
+		}
 
 	public:
+		/** @returns the logger for name, the default logger is a single atomic load after the first call */
 		static Logger* get(const char* name = nullptr);
 
 		static void terminate();
 
+		/* loggers created afterwards write binary records instead of text, see tools/log-decoder */
+		static void setBinaryOutput(bool binaryOutput);
+
+		/* segment size and how many segments are kept for loggers created afterwards */
+		static void setSegmentLimits(size_t segmentSize, size_t segmentCount);
+
+		/* lowest severity that is still logged for the category */
+		static void setSeverity(Category category, Severity severity);
+		static void setSeverity(Severity severity);
+
+		template<typename... Ts>
+		static void recordEvent(Category category, const Ts&... args)
+		{
+			uint32_t id = formatId<LogFormat::argTypeOf<Ts>()...>();
+			if (id != LogFormat::invalidFormat)
+				FlightRecorder::record(id, category, Severity::VERBOSE, args...);
+		}
+
+		static inline bool isEnabled(Category category, Severity severity)
+		{
+			return severity >= severities_[static_cast<size_t>(category)].load(std::memory_order::relaxed);
+		}
+
 	private:
 		static const char* DEFAULT_COLOR;
 		static const char* INFO_COLOR;
 		static const char* WARN_COLOR;
 		static const char* ERROR_COLOR;
 
-		std::string path_;
-		std::ofstream logFile_;
+		LogFile file_;
+		bool isBinary_;
 
-		void forward(const char* str, bool newLine = false);
-		void forward(std::string& str, bool newLine = false);
+		/* formats already written to the binary file, only touched by the log handler thread */
+		std::vector<bool> writtenFormats_;
 
-	public:
-		Logger(const char* path);
-		~Logger();
+		/* while no segment could be created, only touched by the log handler thread */
+		int64_t reopenTime_;
+		uint32_t droppedRecords_;
 
-		enum class Severity
-		{
-			DEFAULT,
-			INFO,
-			WARNING,
-			ERROR,
-		};
+		/** @returns space for a record in the ring of the calling thread or nullptr if it has to be dropped */
+		char* reserve(size_t size);
+		void commit();
+		void close();
 
-		void logRest(const char* str);
-		void logRest(std::string& str);
+		void emit(uint32_t formatId, Category category, Severity severity, const char* args, size_t argsSize, uint32_t repeated, uint32_t dropped);
+		/* args may point into the record reserved by beginText(), it is then published in place instead of copied */
+		void emitAtSite(Site& site, uint32_t formatId, Category category, Severity severity, const char* args, size_t argsSize, char* reserved = nullptr);
+		/* writes the pending repeats of the site if its dedup window ended before now */
+		static void flushSite(Site& site, int64_t now);
 
-		template<typename T, typename... Rest>
-		void logRest(T str, Rest... rest)
-		{
-			logRest(str);
-			logRest(rest...);
-		}
+		/* record reserved by beginText() on this thread */
+		static thread_local char* pendingText_;
 
-		void log(const char* str);
-		void log(std::string& str);
+		/* arguments of a site record while the site decides about it, shared by all write(Site&, ...) instantiations and commitText() */
+		static thread_local char siteArgs_[maxArgsSize];
 
-		template<typename T>
-		void log(T str)
-		{
-			log(str);
-		}
+		void appendRecord(const char* record, size_t size, const char* line, size_t lineSize, std::string& out);
+		void appendRecordAfterDrops(const char* record, size_t size, const char* line, size_t lineSize, std::string& out);
+		void appendBinary(const char* record, size_t size, std::string& out);
 
-		template<typename T, typename... Ts>
-		void log(T str, Ts... rest)
-		{
-			printf("%s", str);
-			forward(str);
-			log(rest...);
-		}
+		/* continues in the next segment, binary segments start with their own header and format entries */
+		void rotate();
 
-	public:
-		template<typename T>
-		void info(T str)
+		/** @returns true if the file is open again, a failed segment is retried once per ENGINE_LOG_REOPEN_INTERVAL_MS */
+		bool reopen();
+		void writeSegmentHeader();
+
+		template<typename... Ts>
+		void write(Site& site, Category category, Severity severity, const Ts&... args)
 		{
-			printf("%s[INFO]%s ", INFO_COLOR, DEFAULT_COLOR);
-			forward("[INFO] ", true);
-			log(str);
+			if (!isEnabled(category, severity))
+				return;
+
+			uint32_t id = formatId<LogFormat::argTypeOf<Ts>()...>();
+			if (id == LogFormat::invalidFormat)
+				return;
+
+			FlightRecorder::record(id, category, severity, args...);
+
+			// encoded up front, the site has to see the arguments before deciding whether the record is written at all
+			size_t argsSize = LogFormat::encodedSize(maxArgsSize, args...);
+			LogFormat::encode(siteArgs_, argsSize, args...);
+
+			emitAtSite(site, id, category, severity, siteArgs_, argsSize);
 		}
 
-		template<typename T>
-		void warn(T str)
+		template<typename... Ts>
+		void write(Category category, Severity severity, const Ts&... args)
 		{
-			printf("%s[WARN]%s ", WARN_COLOR, DEFAULT_COLOR);
-			forward("[WARN] ", true);
-			log(str);
+			static_assert(sizeof...(Ts) > 0, "nothing to log");
+
+			if (!isEnabled(category, severity))
+				return;
+
+			uint32_t id = formatId<LogFormat::argTypeOf<Ts>()...>();
+			if (id == LogFormat::invalidFormat)
+				return;
+
+			FlightRecorder::record(id, category, severity, args...);
+
+			size_t argsSize = LogFormat::encodedSize(maxArgsSize, args...);
+			char* record = reserve(sizeof(LogFormat::RecordHeader) + argsSize);
+			if (record == nullptr)
+				return;
+
+			LogFormat::RecordHeader header = {};
+			header.formatId = id;
+			header.argsSize = static_cast<uint32_t>(argsSize);
+			header.timestamp = LogFormat::now();
+			header.severity = severity;
+			header.category = category;
+
+			memcpy(record, &header, sizeof(header));
+			LogFormat::encode(record + sizeof(header), argsSize, args...);
+			commit();
 		}
 
-		template<typename T>
-		void error(T str)
+	public:
+		Logger(const std::string& directory, const std::string& name, bool isBinary = false);
+		~Logger();
+
+		/* only the arguments are copied here, the text is formatted on the log handler thread */
+		template<typename... Ts>
+		void info(const Ts&... args)
 		{
-			printf("%s[ERROR]%s ", ERROR_COLOR, DEFAULT_COLOR);
-			forward("[ERROR] ", true);
-			log(str);
+			write(Category::GENERAL, Severity::INFO, args...);
 		}
 
-		template<typename T, typename... Ts>
-		void info(T str, Ts... rest)
+		template<typename... Ts>
+		void warn(const Ts&... args)
 		{
-			printf("%s[INFO]%s %s", INFO_COLOR, DEFAULT_COLOR, str);
-			forward("[INFO] ", true);
-			forward(str);
-			logRest(rest...);
-			printf("\n");
-			forward("\n");
+			write(Category::GENERAL, Severity::WARNING, args...);
 		}
 
-		template<typename T, typename... Ts>
-		void warn(T str, Ts... rest)
+		template<typename... Ts>
+		void error(const Ts&... args)
 		{
-			printf("%s[WARN]%s %s", WARN_COLOR, DEFAULT_COLOR, str);
-			forward("[WARN] ", true);
-			forward(str);
-			logRest(rest...);
-			printf("\n");
-			forward("\n");
+			write(Category::GENERAL, Severity::ERROR, args...);
 		}
 
-		template<typename T, typename... Ts>
-		void error(T str, Ts... rest)
+		template<typename... Ts>
+		void log(Severity severity, const Ts&... args)
 		{
-			printf("%s[ERROR]%s %s", ERROR_COLOR, DEFAULT_COLOR, str);
-			forward("[ERROR] ", true);
-			forward(str);
-			logRest(rest...);
-			printf("\n");
-			forward("\n");
+			write(Category::GENERAL, severity, args...);
 		}
 
 		template<typename... Ts>
-		void log(Severity type, Ts... rest)
+		void log(Category category, Severity severity, const Ts&... args)
 		{
-			switch (type)
-			{
-			case Severity::INFO:
-				info(rest...);
-				break;
-			case Severity::WARNING:
-				warn(rest...);
-				break;
-			case Severity::ERROR:
-				error(rest...);
-				break;
-			case Severity::DEFAULT:
-			default:
-				info(rest...);
-				break;
-			}
+			write(category, severity, args...);
 		}
 
-		template<typename T>
-		void log(Severity type, T str)
+		/**
+		 * Writes a single string record in place, for text that is produced straight into the log (e.g. by V8).
+		 * @returns space for up to *maxLength bytes or nullptr if nothing should be logged, finish it with commitText()
+		 * nothing else may be logged on this thread in between
+		 */
+		char* beginText(Category category, Severity severity, size_t* maxLength);
+
+		/* the record goes through the site's folding and rate limit, a folded or dropped record is never published */
+		void commitText(Site& site, size_t length);
+
+		/* deduplicated and rate limited per site, used by the ENGINE_LOG macros */
+		template<typename... Ts>
+		void log(Site& site, Category category, Severity severity, const Ts&... args)
 		{
-			switch (type)
-			{
-			case Severity::INFO:
-				info(str);
-				break;
-			case Severity::WARNING:
-				warn(str);
-				break;
-			case Severity::ERROR:
-				error(str);
-				break;
-			case Severity::DEFAULT:
-			default:
-				info(str);
-				break;
-			}
+			write(site, category, severity, args...);
 		}
 	};
 }
@@ -3,6 +3,8 @@
 
 #include "framework.hpp"
 #include "SubSystem.hpp"
+#include "LockProfiler.hpp"
+#include "job_system/AsyncMutex.hpp"
 
 #define SCRIPT_METHOD(name) static void name(const v8::FunctionCallbackInfo<v8::Value>& args)
 
@@ -54,7 +56,9 @@ namespace NovaEngine
 			context_(),
 			scriptManagerReference_(),
 			modules_(),
-			moduleRequireCounter_(0)
+			moduleRequireCounter_(0),
+			isolateLockStats_("ScriptManager::isolateMutex_"),
+			isolateMutex_("ScriptManager::isolateMutex_")
 		{}
 
 		static void onRequire(const v8::FunctionCallbackInfo<v8::Value>& args);
@@ -68,9 +72,19 @@ namespace NovaEngine
 		v8::Global<v8::Number> scriptManagerReference_;
 		std::unordered_map<std::string, v8::Global<v8::Object>> modules_;
 		size_t moduleRequireCounter_;
+		LockStats isolateLockStats_;
+		JobSystem::AsyncMutex isolateMutex_;
 
 		std::string getRelativePath(const std::string& str);
 
+		inline void recordIsolateLock(std::chrono::steady_clock::time_point lockStart, bool isContended, const std::source_location& location)
+		{
+#ifdef ENGINE_LOCK_PROFILING
+			uint64_t waitNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - lockStart).count();
+			isolateLockStats_.record(location, isContended, waitNs);
+#endif
+		}
+
 	protected:
 		static std::vector<ScriptManager*> instances_;
 
@@ -91,11 +105,44 @@ namespace NovaEngine
 		v8::Isolate* isolate();
 		v8::Local<v8::Context> context();
 
+		/**
+		 * Every entry into the isolate (run, load, reload) has to hold this mutex. Jobs take it with
+		 * co_await scriptManager.isolateMutex().lock(); scriptManager.run(...); scriptManager.isolateMutex().unlock();
+		 * everything else uses lockIsolate() or runLocked().
+		 */
+		JobSystem::AsyncMutex& isolateMutex() { return isolateMutex_; }
+
+		/* blocking acquire of isolateMutex() for threads outside the job system, never call it from a job */
+		void lockIsolate(const std::source_location& location = std::source_location::current())
+		{
+			auto lockStart = std::chrono::steady_clock::now();
+			bool isContended = false;
+
+			while (!isolateMutex_.tryLock())
+			{
+				isContended = true;
+				std::this_thread::yield();
+			}
+
+			recordIsolateLock(lockStart, isContended, location);
+		}
+
+		/* isolateMutex() has to be held */
 		void load(const char* path, bool isJsonModule = false);
 
+		/**
+		 * Runs an already loaded module again, modules that require it afterwards get the new exports.
+		 * isolateMutex() has to be held.
+		 * @returns false if the module was never loaded
+		 */
+		bool reload(const char* path, bool isJsonModule = false);
+
+		/* isolateMutex() has to be held, the v8::Locker then only binds the isolate to this thread */
 		template<typename RunCallback>
 		void run(RunCallback callback)
 		{
+			assert(isolateMutex_.isLocked());
+
 			v8::Locker isolateLocker(isolate_);
 			v8::Isolate::Scope isolate_scope(isolate_);
 
@@ -107,6 +154,15 @@ namespace NovaEngine
 			callback(runInfo);
 		}
 
+		/* run() for threads outside the job system, takes isolateMutex() for the duration of the callback */
+		template<typename RunCallback>
+		void runLocked(RunCallback callback, const std::source_location& location = std::source_location::current())
+		{
+			lockIsolate(location);
+			run(callback);
+			isolateMutex_.unlock();
+		}
+
 
 	private:
 		void handleRequire(const v8::FunctionCallbackInfo<v8::Value>& args);
@@ -15,14 +15,17 @@
 #include <limits>
 #include <functional>
 #include <unordered_map>
+#include <unordered_set>
 #include <type_traits>
 #include <filesystem>
 #include <stdarg.h>
 #include <ctime>
 #include <thread>
+#include <chrono>
 #include <mutex>
 #include <condition_variable>
 #include <queue>
+#include <list>
 #include <csignal>
 #include <cstdlib>
 #include <stdlib.h>
@@ -31,11 +34,19 @@
 #include <optional>
 #include <stack>
 #include <coroutine>
+#include <span>
+#include <string_view>
 
 #include <libgen.h>
 #include <unistd.h>
 #include <linux/limits.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <fcntl.h>
 
 #include <v8/v8.h>
 #include <v8/libplatform/libplatform.h>
@@ -7,6 +7,7 @@
 #include "graphics/VkUtils.hpp"
 #include "graphics/VkFactory.hpp"
 #include "graphics/Color.hpp"
+#include "Logger.hpp"
 
 namespace NovaEngine::Graphics
 {
@@ -163,7 +164,8 @@ namespace NovaEngine::Graphics
 					// printf("wait %i\n", ++i);
 					if (didResize_)
 					{
-						printf("did resize\n");
+						ENGINE_FLIGHT_EVENT(GRAPHICS, "resize while acquiring image of frame ", currentFrame_);
+						ENGINE_LOG_VERBOSE(GRAPHICS, "Resizing swapchain while waiting for the next image");
 						
 						resizeSwapchain();
 						didResize_ = false;
@@ -179,6 +181,7 @@ namespace NovaEngine::Graphics
 
 			if (result == VK_ERROR_OUT_OF_DATE_KHR)
 			{
+				ENGINE_FLIGHT_EVENT(GRAPHICS, "swapchain out of date on acquire, frame ", currentFrame_);
 				resizeSwapchain();
 				return;
 			}
@@ -231,7 +234,8 @@ namespace NovaEngine::Graphics
 
 			if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || didResize_)
 			{
-				printf("did resize 2...\n");
+				ENGINE_FLIGHT_EVENT(GRAPHICS, "resize after present, result ", static_cast<int32_t>(result), ", frame ", currentFrame_);
+				ENGINE_LOG_VERBOSE(GRAPHICS, "Resizing swapchain after present");
 				resizeSwapchain();
 				didResize_ = false;
 				// present(onWaitCallback);
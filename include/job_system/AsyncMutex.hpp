@@ -0,0 +1,30 @@
+#ifndef ENGINE_JOB_SYSTEM_ASYNC_MUTEX_HPP
+#define ENGINE_JOB_SYSTEM_ASYNC_MUTEX_HPP
+
+#include "framework.hpp"
+#include "job_system/AsyncSemaphore.hpp"
+
+namespace NovaEngine::JobSystem
+{
+	/**
+	 * Mutex for jobs: co_await mutex.lock() suspends a contended job instead of blocking the worker,
+	 * unlock() hands the mutex directly to the next waiting job.
+	 */
+	class AsyncMutex
+	{
+	private:
+		AsyncSemaphore semaphore_;
+
+	public:
+		AsyncMutex(const char* name = "JobSystem::AsyncMutex") : semaphore_(1, name) {}
+
+		AsyncSemaphore::Awaiter lock() { return semaphore_.acquire(); }
+		bool tryLock() { return semaphore_.tryAcquire(); }
+		void unlock() { semaphore_.release(1); }
+
+		/* only tells that someone holds the mutex, not who */
+		bool isLocked() { return semaphore_.available() == 0; }
+	};
+}
+
+#endif
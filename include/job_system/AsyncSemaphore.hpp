@@ -0,0 +1,60 @@
+#ifndef ENGINE_JOB_SYSTEM_ASYNC_SEMAPHORE_HPP
+#define ENGINE_JOB_SYSTEM_ASYNC_SEMAPHORE_HPP
+
+#include "framework.hpp"
+#include "LockProfiler.hpp"
+#include "job_system/Job.hpp"
+
+namespace NovaEngine::JobSystem
+{
+	class JobScheduler;
+
+	/**
+	 * Counting semaphore for jobs. A job that can't acquire suspends with co_await semaphore.acquire()
+	 * and is requeued by release() instead of blocking its worker thread.
+	 */
+	class AsyncSemaphore
+	{
+	private:
+		struct Waiter
+		{
+			JobHandle handle;
+			JobScheduler* scheduler;
+		};
+
+		InstrumentedMutex mutex_;
+		size_t count_;
+		std::queue<Waiter> waiters_;
+
+	public:
+		struct Awaiter
+		{
+			AsyncSemaphore& semaphore;
+
+			bool await_ready() { return semaphore.tryAcquire(); }
+			bool await_suspend(JobHandle handle) { return semaphore.suspend(handle); }
+			void await_resume() const noexcept {}
+		};
+
+		AsyncSemaphore(size_t count, const char* name = "JobSystem::AsyncSemaphore") : mutex_(name), count_(count), waiters_() {}
+
+		AsyncSemaphore(const AsyncSemaphore&) = delete;
+		AsyncSemaphore& operator=(const AsyncSemaphore&) = delete;
+
+		/* only usable with co_await from within a job */
+		Awaiter acquire() { return { *this }; }
+
+		bool tryAcquire();
+
+		/* units that can be acquired right now without waiting */
+		size_t available();
+
+		/* hands the units to waiting jobs first (in fifo order) and keeps the rest */
+		void release(size_t count = 1);
+
+	private:
+		bool suspend(JobHandle handle);
+	};
+}
+
+#endif
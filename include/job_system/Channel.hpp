@@ -0,0 +1,183 @@
+#ifndef ENGINE_JOB_SYSTEM_CHANNEL_HPP
+#define ENGINE_JOB_SYSTEM_CHANNEL_HPP
+
+#include "framework.hpp"
+#include "job_system/Job.hpp"
+#include "job_system/JobScheduler.hpp"
+
+namespace NovaEngine::JobSystem
+{
+	/**
+	 * Bounded lock-free multi producer / single consumer channel between jobs.
+	 * Producers call send() from anywhere, the consuming job suspends in co_await channel.receive()
+	 * until a value arrives (or the channel is closed) and is requeued by the send that fills it.
+	 */
+	template<typename T>
+	class Channel
+	{
+	private:
+		struct Cell
+		{
+			std::atomic<size_t> sequence;
+			alignas(T) unsigned char storage[sizeof(T)];
+
+			T* value() { return reinterpret_cast<T*>(storage); }
+		};
+
+		std::unique_ptr<Cell[]> cells_;
+		size_t mask_;
+		alignas(64) std::atomic<size_t> sendPosition_;
+		alignas(64) size_t receivePosition_;
+		std::atomic<void*> waiter_;
+		JobScheduler* waiterScheduler_;
+		std::atomic<bool> isClosed_;
+
+		static size_t roundCapacity(size_t capacity)
+		{
+			size_t rounded = 2;
+			while (rounded < capacity)
+				rounded <<= 1;
+			return rounded;
+		}
+
+		void wakeReceiver()
+		{
+			// pairs with the fence in await_suspend so either the sender sees the waiter or the receiver sees the value
+			std::atomic_thread_fence(std::memory_order::seq_cst);
+
+			void* waiter = waiter_.load(std::memory_order::acquire);
+			if (waiter != nullptr && waiter_.compare_exchange_strong(waiter, nullptr, std::memory_order::acq_rel))
+				waiterScheduler_->resumeJob(JobHandle::from_address(waiter));
+		}
+
+		bool hasValue()
+		{
+			Cell& cell = cells_[receivePosition_ & mask_];
+			return cell.sequence.load(std::memory_order::acquire) == receivePosition_ + 1;
+		}
+
+	public:
+		struct ReceiveAwaiter
+		{
+			Channel& channel;
+
+			bool await_ready() { return channel.hasValue() || channel.isClosed(); }
+
+			bool await_suspend(JobHandle handle)
+			{
+				// the job may run on another thread as soon as waiter_ is published, only touch locals from here on
+				Channel* ch = &channel;
+				void* address = handle.address();
+
+				ch->waiterScheduler_ = JobScheduler::current();
+				ch->waiter_.store(address, std::memory_order::release);
+				std::atomic_thread_fence(std::memory_order::seq_cst);
+
+				if (ch->hasValue() || ch->isClosed())
+				{
+					void* expected = address;
+					if (ch->waiter_.compare_exchange_strong(expected, nullptr, std::memory_order::acq_rel))
+						return false;
+				}
+
+				JobScheduler::parkCurrentJob();
+				return true;
+			}
+
+			/** @returns an empty optional once the channel is closed and drained */
+			std::optional<T> await_resume() { return channel.tryReceive(); }
+		};
+
+		Channel(size_t capacity) :
+			cells_(new Cell[roundCapacity(capacity)]),
+			mask_(roundCapacity(capacity) - 1),
+			sendPosition_(0),
+			receivePosition_(0),
+			waiter_(nullptr),
+			waiterScheduler_(nullptr),
+			isClosed_(false)
+		{
+			for (size_t i = 0; i <= mask_; i++)
+				cells_[i].sequence.store(i, std::memory_order::relaxed);
+		}
+
+		~Channel()
+		{
+			while (tryReceive().has_value())
+				;
+		}
+
+		Channel(const Channel&) = delete;
+		Channel& operator=(const Channel&) = delete;
+
+		/** @returns false if the channel is full or closed, an lvalue is copied and an rvalue only moved from once it was sent */
+		bool send(const T& value) { return trySend(value); }
+		bool send(T&& value) { return trySend(std::move(value)); }
+
+		/* only the single consumer may receive */
+		ReceiveAwaiter receive() { return { *this }; }
+
+		std::optional<T> tryReceive()
+		{
+			Cell& cell = cells_[receivePosition_ & mask_];
+
+			if (cell.sequence.load(std::memory_order::acquire) != receivePosition_ + 1)
+				return std::nullopt;
+
+			std::optional<T> value(std::move(*cell.value()));
+			cell.value()->~T();
+			cell.sequence.store(receivePosition_ + mask_ + 1, std::memory_order::release);
+			receivePosition_++;
+
+			return value;
+		}
+
+		void close()
+		{
+			isClosed_.store(true, std::memory_order::release);
+			wakeReceiver();
+		}
+
+		bool isClosed() { return isClosed_.load(std::memory_order::acquire); }
+
+	private:
+		template<typename Value>
+		bool trySend(Value&& value)
+		{
+			if (isClosed())
+				return false;
+
+			size_t position = sendPosition_.load(std::memory_order::relaxed);
+			Cell* cell;
+
+			while (true)
+			{
+				cell = &cells_[position & mask_];
+				size_t sequence = cell->sequence.load(std::memory_order::acquire);
+				intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+				if (difference == 0)
+				{
+					if (sendPosition_.compare_exchange_weak(position, position + 1, std::memory_order::relaxed))
+						break;
+				}
+				else if (difference < 0)
+				{
+					return false; // full
+				}
+				else
+				{
+					position = sendPosition_.load(std::memory_order::relaxed);
+				}
+			}
+
+			new (cell->storage) T(std::forward<Value>(value));
+			cell->sequence.store(position + 1, std::memory_order::release);
+
+			wakeReceiver();
+			return true;
+		}
+	};
+}
+
+#endif
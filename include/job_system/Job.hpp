@@ -7,6 +7,17 @@ namespace NovaEngine::JobSystem
 {
 	typedef std::atomic<size_t> Counter;
 
+	enum class JobPriority
+	{
+		HIGH,
+		NORMAL,
+		LOW,
+		COUNT,
+	};
+
+	typedef std::chrono::steady_clock::time_point JobDeadline;
+	constexpr JobDeadline noDeadline = JobDeadline::max();
+
 	struct Job
 	{
 		struct State
@@ -30,6 +41,9 @@ namespace NovaEngine::JobSystem
 		struct promise_type
 		{
 			State state;
+			JobPriority priority = JobPriority::NORMAL;
+			uintptr_t affinity = 0;
+			JobDeadline deadline = noDeadline;
 			promise_type() = default;
 			Job get_return_object() { return { std::coroutine_handle<promise_type>::from_promise(*this) }; }
 			std::suspend_always initial_suspend() { return {}; }
@@ -7,6 +7,7 @@
 #include <coroutine>
 #include "job_system/Job.hpp"
 #include "job_system/Queue.hpp"
+#include "job_system/ReadyQueue.hpp"
 #include "job_system/WaitList.hpp"
 
 #define JOB(name) NovaEngine::JobSystem::Job name(NovaEngine::JobSystem::Counter* __COROUTINE_COUNTER__, NovaEngine::JobSystem::JobScheduler* scheduler, NovaEngine::Engine* engine, void* arg)
@@ -17,31 +18,105 @@
 #define ENGINE_JOB_SYSTEM_MAX_JOBS 200
 #endif
 
+/* how long (in microseconds) a worker has to find no work before it parks */
+#ifndef ENGINE_JOB_SYSTEM_PARK_DELAY_US
+#define ENGINE_JOB_SYSTEM_PARK_DELAY_US 10000
+#endif
+
+/* a parked worker is woken once there are more than this many ready jobs per active worker */
+#ifndef ENGINE_JOB_SYSTEM_UNPARK_DEPTH
+#define ENGINE_JOB_SYSTEM_UNPARK_DEPTH 2
+#endif
+
+#ifndef ENGINE_JOB_SYSTEM_AFFINITY_SLOTS
+#define ENGINE_JOB_SYSTEM_AFFINITY_SLOTS 256
+#endif
+
 
 namespace NovaEngine::JobSystem
 {
 	class JobScheduler;
 
+	/* what happens to a submission when its priority class is already at its job limit */
+	enum class AdmissionPolicy
+	{
+		BLOCK, // wait on the submitting thread until jobs of that class finish
+		HELP, // run other ready jobs on the submitting thread until there is room again, threads other than the workers and exec() BLOCK (REJECT while no worker runs)
+		REJECT, // refuse the submission and return SubmitStatus::REJECTED
+	};
+
+	enum class SubmitStatus
+	{
+		SUBMITTED,
+		REJECTED,
+	};
+
 	typedef Job(*JobFunction)(Counter* counter, NovaEngine::JobSystem::JobScheduler* scheduler, NovaEngine::Engine* engine, void* arg);
 
 	struct JobInfo
 	{
 		JobFunction function = nullptr;
 		void* arg = nullptr;
+		JobPriority priority = JobPriority::NORMAL;
+		/* jobs with the same non zero affinity key prefer to run on the worker that last ran that key */
+		uintptr_t affinity = 0;
+		/* jobs with a deadline run before the other jobs of their priority class, earliest deadline first */
+		JobDeadline deadline = noDeadline;
 
 		template<typename T>
-		JobInfo(JobFunction function, T arg) : function(function), arg(reinterpret_cast<void*>(arg)) {}
+		JobInfo(JobFunction function, T arg, JobPriority priority = JobPriority::NORMAL, uintptr_t affinity = 0, JobDeadline deadline = noDeadline) :
+			function(function), arg(reinterpret_cast<void*>(arg)), priority(priority), affinity(affinity), deadline(deadline) {}
 
-		JobInfo(JobFunction function = nullptr, void* arg = nullptr) : function(function), arg(arg) {}
+		JobInfo(JobFunction function = nullptr, void* arg = nullptr, JobPriority priority = JobPriority::NORMAL, uintptr_t affinity = 0, JobDeadline deadline = noDeadline) :
+			function(function), arg(arg), priority(priority), affinity(affinity), deadline(deadline) {}
 	};
 
 	class JobScheduler : public SubSystem<size_t, size_t>
 	{
+	public:
+		struct Stats
+		{
+			std::atomic<size_t> affinityHits; // affinity jobs that ran on the worker that last ran their key
+			std::atomic<size_t> affinityMisses; // affinity jobs whose key had no worker yet
+			std::atomic<size_t> affinitySteals; // affinity jobs taken from another worker's queue
+			std::atomic<size_t> deadlineJobs; // finished jobs that had a deadline
+			std::atomic<size_t> missedDeadlines; // of those, the ones that finished after it
+			std::atomic<size_t> parks; // times a worker went to sleep for lack of work
+			std::atomic<size_t> unparks;
+		};
+
 	private:
+		static constexpr size_t priorityCount_ = static_cast<size_t>(JobPriority::COUNT);
+		static constexpr size_t noWorker_ = std::numeric_limits<size_t>::max();
+
+		static thread_local size_t workerIndex_;
+		static thread_local JobScheduler* currentScheduler_;
+		static thread_local bool isJobParked_;
+
+		struct Worker
+		{
+			ReadyQueue readyQueues[priorityCount_];
+			std::atomic<bool> isParked = false;
+		};
+
 		size_t maxJobs_;
-		Queue<JobHandle> readyQueue_;
+		ReadyQueue readyQueues_[priorityCount_];
+		AdmissionPolicy admissionPolicies_[priorityCount_];
+		size_t admissionLimits_[priorityCount_];
+		std::atomic<size_t> activeJobs_[priorityCount_];
+		std::atomic<size_t> totalActiveJobs_;
+		std::vector<std::unique_ptr<Worker>> workers_;
+		std::atomic<size_t> affinityOwners_[ENGINE_JOB_SYSTEM_AFFINITY_SLOTS];
+		Stats stats_;
+		std::atomic<size_t> readyJobs_;
+		size_t minWorkers_;
+		std::atomic<size_t> activeWorkers_;
+		std::atomic<size_t> parkedWorkers_;
+		size_t unparkRequests_;
+		InstrumentedMutex parkMutex_;
+		std::condition_variable_any parkCv_;
 		List<JobHandle> waitList_;
-		std::mutex jobYieldMutex_;
+		InstrumentedMutex jobYieldMutex_;
 
 		std::vector<std::thread> threads_;
 		std::thread::id mainThreadID_;
@@ -50,31 +125,106 @@ namespace NovaEngine::JobSystem
 
 		ENGINE_SUB_SYSTEM_CTOR(JobScheduler),
 			maxJobs_(ENGINE_JOB_SYSTEM_MAX_JOBS),
-			readyQueue_(),
-			waitList_(),
-			jobYieldMutex_(),
+			readyQueues_(),
+			admissionPolicies_(),
+			admissionLimits_(),
+			activeJobs_(),
+			totalActiveJobs_(),
+			workers_(),
+			affinityOwners_(),
+			stats_(),
+			readyJobs_(),
+			minWorkers_(1),
+			activeWorkers_(),
+			parkedWorkers_(),
+			unparkRequests_(0),
+			parkMutex_("JobScheduler::parkMutex_"),
+			parkCv_(),
+			waitList_("JobScheduler::waitList_"),
+			jobYieldMutex_("JobScheduler::jobYieldMutex_"),
 			threads_(),
 			mainThreadID_(std::this_thread::get_id()),
 			threadsRunning_(),
 			executionThreads_(1)
 		{
 			threadsRunning_.store(0);
+			totalActiveJobs_.store(0);
+
+			for (size_t i = 0; i < priorityCount_; i++)
+			{
+				admissionPolicies_[i] = AdmissionPolicy::HELP;
+				admissionLimits_[i] = 0;
+				activeJobs_[i].store(0);
+			}
+
+			for (auto& owner : affinityOwners_)
+				owner.store(noWorker_);
+
+			stats_.affinityHits.store(0);
+			stats_.affinityMisses.store(0);
+			stats_.affinitySteals.store(0);
+			stats_.deadlineJobs.store(0);
+			stats_.missedDeadlines.store(0);
+			stats_.parks.store(0);
+			stats_.unparks.store(0);
+			readyJobs_.store(0);
+			activeWorkers_.store(0);
+			parkedWorkers_.store(0);
 		}
 
 	protected:
 		bool onInitialize(size_t maxJobs, size_t executionThreads);
 		bool onTerminate();
 		bool runNextJob(JobHandle* handleOut);
-		void threadEntry(size_t threadID);
+		bool popReady(size_t priority, JobHandle* handleOut);
+		void threadEntry(size_t workerIndex);
+		bool tryPark(size_t workerIndex);
+		void unparkWorker();
 		bool handleJobYield(JobHandle* handle);
+		void pushReady(JobHandle handle);
+
+		bool tryAdmit(size_t priority, size_t jobsCount);
+		void releaseAdmission(size_t priority, size_t jobsCount);
+		bool admit(const size_t* jobsPerPriority);
 
 	public:
-		Counter* runJobs(JobInfo* jobs, size_t jobsCount);
-		Counter* runJob(JobInfo jobs);
-		Counter* runJob(JobFunction func);
+		/**
+		 * Sets how submissions of the given priority class are throttled once that class has maxJobs unfinished jobs.
+		 * A maxJobs of 0 uses the scheduler wide limit passed to initialize().
+		 */
+		void setAdmissionPolicy(JobPriority priority, AdmissionPolicy policy, size_t maxJobs = 0);
+
+		/**
+		 * Idle workers park until the ready queues fill up again, but never below minWorkers running workers.
+		 * maxWorkers (0 keeps the current count) is the number of worker threads created and only applies before they start.
+		 */
+		void setWorkerLimits(size_t minWorkers, size_t maxWorkers = 0);
+
+		/** @returns SubmitStatus::REJECTED (and leaves counterOut untouched) if a class with the REJECT policy was full, or a HELP class for a thread that is no worker while none runs */
+		[[nodiscard]] SubmitStatus submitJobs(JobInfo* jobs, size_t jobsCount, Counter** counterOut);
+
+		/** @returns nullptr if the jobs were rejected by the admission policy, none of them runs then */
+		[[nodiscard]] Counter* runJobs(JobInfo* jobs, size_t jobsCount);
+		[[nodiscard]] Counter* runJob(JobInfo jobs);
+		[[nodiscard]] Counter* runJob(JobFunction func);
 
 		void joinThreads();
 
+		/** @returns the scheduler whose job is running on the calling thread */
+		static JobScheduler* current() { return currentScheduler_; }
+
+		/**
+		 * Called from an awaiter's await_suspend when it keeps the suspended job itself instead of handing it back.
+		 * The job is then neither requeued nor put on the wait list until someone passes it to resumeJob().
+		 */
+		static void parkCurrentJob() { isJobParked_ = true; }
+
+		/* makes a job that was parked by an awaiter ready again */
+		void resumeJob(JobHandle handle) { pushReady(handle); }
+
+		const Stats& stats() const { return stats_; }
+		void logStats();
+
 		void execNext()
 		{
 			JobHandle jobHandle;
@@ -82,6 +232,13 @@ namespace NovaEngine::JobSystem
 				handleJobYield(&jobHandle);
 		}
 
+		/* runs ready jobs on the calling thread until none are left, e.g. the jobs resumed while the engine shuts down */
+		void drain()
+		{
+			while (readyJobs_.load(std::memory_order::acquire) != 0)
+				execNext();
+		}
+
 		template<typename LoopConditionCallback, typename LoopCallback>
 		void exec(LoopConditionCallback shouldLoop, LoopCallback loopCallback = []() {})
 		{
@@ -94,6 +251,9 @@ namespace NovaEngine::JobSystem
 			if (didInitializeThreads)
 				initThreads();
 
+			// the main thread owns the last worker slot
+			workerIndex_ = executionThreads_;
+
 			if (didStartThreads)
 				runThreads();
 
@@ -1,163 +1,105 @@
-
 #ifndef ENGINE_JOB_SYSTEM_QUEUE_HPP
 #define ENGINE_JOB_SYSTEM_QUEUE_HPP
 
 #include "framework.hpp"
-
-#define AtomicFalse 0
-#define AtomicTrue 1
+#include "LockProfiler.hpp"
 
 namespace NovaEngine::JobSystem
 {
-	typedef std::lock_guard<std::mutex> scope_lock;
-	typedef std::atomic<int> AtomicBool;
-
 	template<typename T>
 	class Queue
 	{
 	private:
-		std::mutex mutex_;
-		std::condition_variable cv_;
-		AtomicBool isBussy_;
+		InstrumentedMutex mutex_;
 		std::queue<T> queue_;
 
-		inline bool checkAndSetBussy()
-		{
-			int trueValue = AtomicTrue;
-			return !isBussy_.compare_exchange_weak(trueValue, AtomicFalse, std::memory_order::seq_cst);
-		}
-
 	public:
-		Queue() : mutex_(), cv_(), isBussy_(), queue_()
-		{
-			isBussy_.store(AtomicFalse, std::memory_order::seq_cst);
-		}
+		Queue(const char* name = "JobSystem::Queue") : mutex_(name), queue_() {}
 
-		bool isEmpty()
+		bool isEmpty(const std::source_location& location = std::source_location::current())
 		{
-			std::unique_lock<std::mutex> lock(mutex_);
-			int f = AtomicTrue;
-			cv_.wait(lock, [&] { return checkAndSetBussy(); });
-
-			bool wasEmpty = queue_.empty();
-
-			lock.unlock();
-			isBussy_.store(AtomicFalse, std::memory_order::seq_cst);
-			cv_.notify_all();
-
-			return wasEmpty;
+			InstrumentedLock lock(mutex_, location);
+			return queue_.empty();
 		}
 
-		bool isEmptyWeak()
+		bool isEmptyWeak(const std::source_location& location = std::source_location::current())
 		{
-			if (!mutex_.try_lock())
+			if (!mutex_.try_lock(location))
 				return false;
 
 			bool wasEmpty = queue_.empty();
 
 			mutex_.unlock();
-			cv_.notify_all();
 
 			return wasEmpty;
 		}
 
-
-		bool push(T&& item)
+		bool push(T&& item, const std::source_location& location = std::source_location::current())
 		{
-			std::unique_lock<std::mutex> lock(mutex_);
-			int f = AtomicTrue;
-			cv_.wait(lock, [&] { return checkAndSetBussy(); });
-
+			InstrumentedLock lock(mutex_, location);
 			queue_.push(std::move(item));
-
-			lock.unlock();
-			isBussy_.store(AtomicFalse, std::memory_order::seq_cst);
-			cv_.notify_all();
-
 			return true;
 		}
 
-		bool pushWeak(T&& item)
+		bool pushWeak(T&& item, const std::source_location& location = std::source_location::current())
 		{
-			if (!mutex_.try_lock())
+			if (!mutex_.try_lock(location))
 				return false;
 
 			queue_.push(std::move(item));
 
 			mutex_.unlock();
-			cv_.notify_all();
 
 			return true;
 		}
 
-		bool push(T& item)
+		bool push(T& item, const std::source_location& location = std::source_location::current())
 		{
-			std::unique_lock<std::mutex> lock(mutex_);
-			int f = AtomicTrue;
-			cv_.wait(lock, [&] { return checkAndSetBussy(); });
-
+			InstrumentedLock lock(mutex_, location);
 			queue_.push(item);
-
-			lock.unlock();
-			isBussy_.store(AtomicFalse, std::memory_order::seq_cst);
-			cv_.notify_all();
-
 			return true;
 		}
 
-		bool pushWeak(T& item)
+		bool pushWeak(T& item, const std::source_location& location = std::source_location::current())
 		{
-			if (!mutex_.try_lock())
+			if (!mutex_.try_lock(location))
 				return false;
 
 			queue_.push(item);
 
 			mutex_.unlock();
-			cv_.notify_all();
 
 			return true;
 		}
 
-		bool pop(T* itemPtr)
+		bool pop(T* itemPtr, const std::source_location& location = std::source_location::current())
 		{
-			std::unique_lock<std::mutex> lock(mutex_);
-			cv_.wait(lock, [&] { return checkAndSetBussy(); });
+			InstrumentedLock lock(mutex_, location);
 
 			if (queue_.empty())
-			{
-				lock.unlock();
-				isBussy_.store(AtomicFalse, std::memory_order::seq_cst);
-				cv_.notify_all();
 				return false;
-			}
 
 			*itemPtr = queue_.front();
 			queue_.pop();
 
-			lock.unlock();
-			isBussy_.store(AtomicFalse, std::memory_order::seq_cst);
-			cv_.notify_all();
-
 			return true;
 		}
 
-		bool popWeak(T* itemPtr)
+		bool popWeak(T* itemPtr, const std::source_location& location = std::source_location::current())
 		{
-			if (!mutex_.try_lock())
+			if (!mutex_.try_lock(location))
 				return false;
 
 			if (queue_.empty())
 			{
 				mutex_.unlock();
-				cv_.notify_all();
 				return false;
 			}
 
-			*itemPtr = queue_.back();
+			*itemPtr = queue_.front();
 			queue_.pop();
 
 			mutex_.unlock();
-			cv_.notify_all();
 
 			return true;
 		}
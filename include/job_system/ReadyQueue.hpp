@@ -0,0 +1,83 @@
+#ifndef ENGINE_JOB_SYSTEM_READY_QUEUE_HPP
+#define ENGINE_JOB_SYSTEM_READY_QUEUE_HPP
+
+#include "framework.hpp"
+#include "LockProfiler.hpp"
+#include "job_system/Job.hpp"
+
+namespace NovaEngine::JobSystem
+{
+	/* queue of runnable jobs: jobs with a deadline come out earliest deadline first, ahead of the fifo ordered rest */
+	class ReadyQueue
+	{
+	private:
+		struct DeadlineEntry
+		{
+			JobDeadline deadline;
+			JobHandle handle;
+
+			bool operator>(const DeadlineEntry& other) const { return deadline > other.deadline; }
+		};
+
+		InstrumentedMutex mutex_;
+		std::queue<JobHandle> queue_;
+		std::priority_queue<DeadlineEntry, std::vector<DeadlineEntry>, std::greater<DeadlineEntry>> deadlines_;
+
+		inline void take(JobHandle* handleOut)
+		{
+			if (!deadlines_.empty())
+			{
+				*handleOut = deadlines_.top().handle;
+				deadlines_.pop();
+			}
+			else
+			{
+				*handleOut = queue_.front();
+				queue_.pop();
+			}
+		}
+
+	public:
+		ReadyQueue(const char* name = "JobSystem::ReadyQueue") : mutex_(name), queue_(), deadlines_() {}
+
+		void push(JobHandle handle, const std::source_location& location = std::source_location::current())
+		{
+			JobDeadline deadline = handle.promise().deadline;
+
+			InstrumentedLock lock(mutex_, location);
+
+			if (deadline != noDeadline)
+				deadlines_.push({ deadline, handle });
+			else
+				queue_.push(handle);
+		}
+
+		bool pop(JobHandle* handleOut, const std::source_location& location = std::source_location::current())
+		{
+			InstrumentedLock lock(mutex_, location);
+
+			if (queue_.empty() && deadlines_.empty())
+				return false;
+
+			take(handleOut);
+			return true;
+		}
+
+		bool popWeak(JobHandle* handleOut, const std::source_location& location = std::source_location::current())
+		{
+			if (!mutex_.try_lock(location))
+				return false;
+
+			bool isEmpty = queue_.empty() && deadlines_.empty();
+
+			if (!isEmpty)
+				take(handleOut);
+
+			mutex_.unlock();
+
+			return !isEmpty;
+		}
+	};
+}
+
+#endif
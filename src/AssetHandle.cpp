@@ -0,0 +1,63 @@
+#include "AssetHandle.hpp"
+#include "job_system/JobScheduler.hpp"
+
+namespace NovaEngine
+{
+	void AssetHandle::State::complete(bool isLoaded, AssetView view)
+	{
+		std::vector<Waiter> woken;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			this->isLoaded = isLoaded;
+			this->view = std::move(view);
+			isDone = true;
+			woken.swap(waiters);
+		}
+
+		doneCv.notify_all();
+
+		for (Waiter& waiter : woken)
+			waiter.scheduler->resumeJob(waiter.handle);
+	}
+
+	bool AssetHandle::suspend(JobSystem::JobHandle handle)
+	{
+		std::lock_guard<std::mutex> lock(state_->mutex);
+
+		// finished between await_ready and now, continue without suspending
+		if (state_->isDone)
+			return false;
+
+		state_->waiters.push_back({ handle, JobSystem::JobScheduler::current() });
+		JobSystem::JobScheduler::parkCurrentJob();
+
+		return true;
+	}
+
+	bool AssetHandle::wait()
+	{
+		std::unique_lock<std::mutex> lock(state_->mutex);
+		state_->doneCv.wait(lock, [&] { return state_->isDone; });
+		return state_->isLoaded;
+	}
+
+	bool AssetHandle::isDone()
+	{
+		std::lock_guard<std::mutex> lock(state_->mutex);
+		return state_->isDone;
+	}
+
+	bool AssetHandle::isLoaded()
+	{
+		std::lock_guard<std::mutex> lock(state_->mutex);
+		return state_->isLoaded;
+	}
+
+	AssetView AssetHandle::view()
+	{
+		std::lock_guard<std::mutex> lock(state_->mutex);
+		return state_->view;
+	}
+};
@@ -1,4 +1,6 @@
 #include "AssetManager.hpp"
+#include "BlockCompression.hpp"
+#include "Engine.hpp"
 #include "Logger.hpp"
 
 namespace NovaEngine
@@ -6,46 +8,1024 @@ namespace NovaEngine
 	bool AssetManager::onInitialize(const char* execPath)
 	{
 		rootDir_ = Utils::Path::combine(execPath, "assets").string();
-		Logger::get()->info("Loaded AssetManager with rootDir: ", rootDir_.c_str());
+		ENGINE_LOG_INFO(ASSET, "Loaded AssetManager with rootDir: ", rootDir_.c_str());
+
+		// packed builds ship assets.pak next to the executable, during development only the loose files exist
+		std::string archivePath = Utils::Path::combine(execPath, "assets.pak").string();
+		if (access(archivePath.c_str(), R_OK) == 0 && !mountArchive(archivePath))
+			ENGINE_LOG_WARN(ASSET, "Could not mount asset archive ", archivePath, ", using the loose files instead!");
+
+		loadDependencies();
+
+		isIoRunning_ = true;
+		for (size_t i = 0; i < ENGINE_ASSET_IO_THREADS; i++)
+			ioThreads_.emplace_back(&AssetManager::ioThreadEntry, this);
+
+		// started before anything is requested, the reads overlap with the startup of the other subsystems
+		prefetchManifestPath_ = Utils::Path::combine(execPath, "assets.prefetch").string();
+
+		std::vector<std::string> prefetchPaths;
+		size_t prefetchBytes = 0;
+		if (readPrefetchManifest(prefetchPaths, &prefetchBytes) && !prefetchPaths.empty())
+		{
+			ENGINE_LOG_INFO(ASSET, "Prefetching ", prefetchPaths.size(), " assets (", prefetchBytes, " bytes) of ", prefetchManifestPath_);
+
+			isPrefetching_ = true;
+			prefetchThread_ = std::thread(&AssetManager::prefetchThreadEntry, this, std::move(prefetchPaths));
+		}
+
 		return true;
 	}
 
 	bool AssetManager::onTerminate()
 	{
+		stopWatching();
+
+		if (prefetchThread_.joinable())
+		{
+			isPrefetching_ = false;
+			prefetchThread_.join();
+		}
+
+		if (isPrefetchManifestWritten_ && !writePrefetchManifest())
+			ENGINE_LOG_WARN(ASSET, "Could not write the prefetch manifest ", prefetchManifestPath_, "!");
+
+		stopLoading();
+
+		logCacheStats();
+
+		{
+			std::lock_guard<std::mutex> lock(cacheMutex_);
+			cache_.clear();
+			cacheLru_.clear();
+			cacheStats_.residentBytes = 0;
+		}
+
+		archive_ = AssetView();
+		archivePath_.clear();
+
 		return true;
 	}
 
+	void AssetManager::stopLoading()
+	{
+		{
+			std::lock_guard<std::mutex> lock(ioMutex_);
+			isIoRunning_ = false;
+		}
+
+		ioCv_.notify_all();
 
-	bool AssetManager::loadFile(const char* assetPath, std::vector<char>& fileContents)
+		for (std::thread& thread : ioThreads_)
+			thread.join();
+
+		ioThreads_.clear();
+
+		// nobody is going to read them anymore, waiting jobs are resumed with a failed load
+		for (auto& queue : ioQueues_)
+		{
+			while (!queue.empty())
+			{
+				finishLoad(queue.front(), false, AssetView());
+				queue.pop();
+			}
+		}
+	}
+
+	void AssetManager::ioThreadEntry()
+	{
+		while (true)
+		{
+			std::shared_ptr<AssetHandle::State> request;
+
+			{
+				std::unique_lock<std::mutex> lock(ioMutex_);
+
+				ioCv_.wait(lock, [&] {
+					if (!isIoRunning_)
+						return true;
+
+					for (auto& queue : ioQueues_)
+						if (!queue.empty())
+							return true;
+
+					return false;
+				});
+
+				if (!isIoRunning_)
+					return;
+
+				for (auto& queue : ioQueues_)
+				{
+					if (!queue.empty())
+					{
+						request = std::move(queue.front());
+						queue.pop();
+						break;
+					}
+				}
+			}
+
+			AssetView view;
+			bool isLoaded = mapAsset(request->path.c_str(), view, true);
+			finishLoad(request, isLoaded, std::move(view));
+		}
+	}
+
+	std::shared_ptr<AssetHandle::State> AssetManager::acquireCached(const char* assetPath, JobSystem::JobPriority priority, bool* isNew)
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex_);
+
+		auto cached = cache_.find(assetPath);
+		if (cached != cache_.end())
+		{
+			CacheEntry& entry = cached->second;
+
+			if (entry.isResident)
+				cacheStats_.hits++;
+			else
+				cacheStats_.coalesced++;
+
+			cacheLru_.splice(cacheLru_.begin(), cacheLru_, entry.lruPosition);
+
+			*isNew = false;
+			return entry.state;
+		}
+
+		cacheStats_.misses++;
+
+		// normalized, an asset requested as "./a" and "a" is only read ahead once
+		if (isRecordingPrefetch_)
+		{
+			std::string path = std::filesystem::path(assetPath).lexically_normal().string();
+			if (prefetchRecordIndex_.emplace(path, prefetchRecord_.size()).second)
+				prefetchRecord_.push_back({ path });
+		}
+
+		cacheLru_.emplace_front(assetPath);
+
+		CacheEntry& entry = cache_[cacheLru_.front()];
+		entry.state = std::make_shared<AssetHandle::State>(assetPath, priority);
+		entry.lruPosition = cacheLru_.begin();
+
+		*isNew = true;
+		return entry.state;
+	}
+
+	void AssetManager::finishLoad(const std::shared_ptr<AssetHandle::State>& state, bool isLoaded, AssetView view)
+	{
+		size_t size = view.size();
+
+		// uncompressed archived assets point into the archive mapping, which stays mapped whether they are cached or not
+		bool isArchived = !archive_.empty() && view.data() >= archive_.data() && view.data() < archive_.data() + archive_.size();
+		size_t residentSize = isArchived ? 0 : size;
+
+		state->complete(isLoaded, std::move(view));
+
+		std::lock_guard<std::mutex> lock(cacheMutex_);
+
+		auto cached = cache_.find(state->path);
+		if (cached == cache_.end() || cached->second.state != state)
+			return;
+
+		// the next request tries again
+		if (!isLoaded)
+		{
+			cacheLru_.erase(cached->second.lruPosition);
+			cache_.erase(cached);
+			return;
+		}
+
+		if (isRecordingPrefetch_)
+		{
+			auto recorded = prefetchRecordIndex_.find(std::filesystem::path(state->path).lexically_normal().string());
+			if (recorded != prefetchRecordIndex_.end())
+			{
+				prefetchRecord_[recorded->second].size = size;
+				prefetchRecord_[recorded->second].isLoaded = true;
+			}
+		}
+
+		cached->second.size = residentSize;
+		cached->second.isResident = true;
+		cacheStats_.residentBytes += residentSize;
+
+		evictUnused();
+	}
+
+	void AssetManager::evictUnused()
+	{
+		for (auto position = cacheLru_.end(); position != cacheLru_.begin() && cacheStats_.residentBytes > cacheStats_.budget;)
+		{
+			--position;
+
+			auto cached = cache_.find(*position);
+			CacheEntry& entry = cached->second;
+
+			// only the cache holds the state, new handles can only be created under cacheMutex_
+			if (!entry.isResident || entry.state.use_count() > 1)
+				continue;
+
+			cacheStats_.residentBytes -= entry.size;
+			cacheStats_.evictions++;
+
+			cache_.erase(cached);
+			position = cacheLru_.erase(position);
+		}
+	}
+
+	void AssetManager::setCacheBudget(size_t bytes)
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex_);
+		cacheStats_.budget = bytes;
+		evictUnused();
+	}
+
+	AssetManager::CacheStats AssetManager::cacheStats()
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex_);
+		return cacheStats_;
+	}
+
+	void AssetManager::logCacheStats()
+	{
+		CacheStats stats = cacheStats();
+		size_t requests = stats.hits + stats.coalesced + stats.misses;
+
+		ENGINE_LOG_INFO(ASSET, "Asset cache: ", stats.hits, " hits, ", stats.coalesced, " coalesced, ", stats.misses, " misses (",
+			requests == 0 ? 0.0 : 100.0 * (stats.hits + stats.coalesced) / requests, "% hit rate), ", stats.evictions, " evictions");
+		ENGINE_LOG_INFO(ASSET, "Asset cache: ", stats.residentBytes, " of ", stats.budget, " bytes resident");
+	}
+
+	void AssetManager::setPrefetchRecording(bool isRecording)
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex_);
+
+		isRecordingPrefetch_ = isRecording;
+		isPrefetchManifestWritten_ = isRecording;
+
+		if (!isRecording)
+		{
+			prefetchRecord_.clear();
+			prefetchRecordIndex_.clear();
+		}
+	}
+
+	/* one "<size> <asset path>" line per asset, sizes are only used for reporting */
+	bool AssetManager::readPrefetchManifest(std::vector<std::string>& assetPaths, size_t* bytes)
 	{
-		if (!fileExists(assetPath))
+		std::ifstream manifest(prefetchManifestPath_);
+		if (!manifest)
+			return false;
+
+		std::string line;
+		while (std::getline(manifest, line))
 		{
-			Logger::get()->warn("Could not find asset ", assetPath, "!");
+			size_t separator = line.find(' ');
+			if (separator == std::string::npos || separator + 1 == line.size())
+				continue;
+
+			*bytes += strtoull(line.c_str(), nullptr, 10);
+			assetPaths.push_back(line.substr(separator + 1));
+		}
+
+		return true;
+	}
+
+	bool AssetManager::writePrefetchManifest()
+	{
+		std::string manifest;
+
+		{
+			std::lock_guard<std::mutex> lock(cacheMutex_);
+
+			for (const PrefetchEntry& entry : prefetchRecord_)
+				if (entry.isLoaded)
+					manifest += std::to_string(entry.size) + " " + entry.path + "\n";
+		}
+
+		// renamed over the old manifest, a crash while writing leaves the last complete one
+		std::string tempPath = prefetchManifestPath_ + ".tmp";
+
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			file.write(manifest.data(), manifest.size());
+			if (!file)
+				return false;
+		}
+
+		if (rename(tempPath.c_str(), prefetchManifestPath_.c_str()) != 0)
 			return false;
+
+		ENGINE_LOG_INFO(ASSET, "Recorded ", std::count(manifest.begin(), manifest.end(), '\n'), " assets into ", prefetchManifestPath_);
+		return true;
+	}
+
+	void AssetManager::prefetchThreadEntry(std::vector<std::string> assetPaths)
+	{
+		static const uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+
+		size_t prefetched = 0;
+
+		for (const std::string& assetPath : assetPaths)
+		{
+			if (!isPrefetching_.load(std::memory_order::relaxed))
+				break;
+
+			// archived assets are already mapped, only their pages have to be read
+			AssetView view;
+			if (findInArchive(assetPath.c_str(), view))
+			{
+				if (!view.empty())
+				{
+					uintptr_t start = reinterpret_cast<uintptr_t>(view.data()) & ~(pageSize - 1);
+					madvise(reinterpret_cast<void*>(start), reinterpret_cast<uintptr_t>(view.data()) + view.size() - start, MADV_WILLNEED);
+				}
+
+				prefetched++;
+				continue;
+			}
+
+			// starts the readahead without waiting for it, the load later finds the pages in the page cache
+			std::string path = createAbsolutePath(assetPath);
+			int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+			if (fd < 0)
+				continue;
+
+			if (posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED) == 0)
+				prefetched++;
+
+			close(fd);
 		}
 
-		std::string path = createAbsolutePath(assetPath);
+		ENGINE_LOG_VERBOSE(ASSET, "Prefetched ", prefetched, " of ", assetPaths.size(), " assets");
+	}
+
+	void AssetManager::invalidate(const char* assetPath)
+	{
+		std::filesystem::path path = std::filesystem::path(assetPath).lexically_normal();
+
+		std::lock_guard<std::mutex> lock(cacheMutex_);
 
-		Logger::get()->info("Loading file ", path, "...");
+		// keys are the paths as they were requested, "./scripts/a.js" and "scripts/a.js" are the same asset
+		for (auto cached = cache_.begin(); cached != cache_.end();)
+		{
+			if (std::filesystem::path(cached->first).lexically_normal() != path)
+			{
+				++cached;
+				continue;
+			}
 
-		std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
-		std::streamsize size = file.tellg();
+			// a load that is still running completes its handles but is not cached anymore
+			if (cached->second.isResident)
+				cacheStats_.residentBytes -= cached->second.size;
 
-		file.seekg(0, std::ios::beg);
-		fileContents.resize(size);
+			cacheLru_.erase(cached->second.lruPosition);
+			cached = cache_.erase(cached);
+		}
+	}
 
-		if (file.read(fileContents.data(), size))
+	bool AssetManager::watch()
+	{
+		if (watchFd_ >= 0)
 			return true;
-		
-		return false;
+
+		if (!archive_.empty())
+		{
+			ENGINE_LOG_WARN(ASSET, "Not watching the assets, the mounted archive shadows the loose files!");
+			return false;
+		}
+
+		// set before the first watch, a file changing from then on has already been copied instead of mapped
+		isWatching_ = true;
+
+		watchFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		watchWakeFd_ = eventfd(0, EFD_CLOEXEC);
+
+		if (watchFd_ >= 0 && watchWakeFd_ >= 0)
+			watchDirectory("", nullptr);
+
+		if (watchedDirs_.empty())
+		{
+			ENGINE_LOG_WARN(ASSET, "Could not watch ", rootDir_, " for changes!");
+
+			if (watchFd_ >= 0)
+				close(watchFd_);
+			if (watchWakeFd_ >= 0)
+				close(watchWakeFd_);
+
+			watchFd_ = -1;
+			watchWakeFd_ = -1;
+			isWatching_ = false;
+			return false;
+		}
+
+		watchThread_ = std::thread(&AssetManager::watchThreadEntry, this);
+
+		ENGINE_LOG_INFO(ASSET, "Watching ", watchedDirs_.size(), " asset directories for changes");
+		return true;
+	}
+
+	void AssetManager::stopWatching()
+	{
+		if (watchThread_.joinable())
+		{
+			uint64_t wake = 1;
+			if (write(watchWakeFd_, &wake, sizeof(wake)) != sizeof(wake))
+				ENGINE_LOG_WARN(ASSET, "Could not wake the asset watcher!");
+
+			watchThread_.join();
+		}
+
+		if (watchFd_ >= 0)
+		{
+			close(watchFd_);
+			close(watchWakeFd_);
+			watchFd_ = -1;
+			watchWakeFd_ = -1;
+			watchedDirs_.clear();
+		}
+
+		isWatching_ = false;
+	}
+
+	void AssetManager::addReloadListener(ReloadListener listener)
+	{
+		std::lock_guard<std::mutex> lock(reloadMutex_);
+		reloadListeners_.push_back(std::move(listener));
+	}
+
+	void AssetManager::watchDirectory(const std::string& dir, std::set<std::string>* changed)
+	{
+		std::string path = dir.empty() ? rootDir_ : createAbsolutePath(dir);
+
+		// moves also cover the cooker, it writes a .tmp file and renames it over the asset
+		int descriptor = inotify_add_watch(watchFd_, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_CREATE | IN_ONLYDIR);
+		if (descriptor < 0)
+		{
+			ENGINE_LOG_WARN(ASSET, "Could not watch asset directory ", path, "!");
+			return;
+		}
+
+		watchedDirs_[descriptor] = dir;
+
+		std::error_code error;
+		for (const auto& entry : std::filesystem::directory_iterator(path, error))
+		{
+			std::string name = dir.empty() ? entry.path().filename().string() : dir + "/" + entry.path().filename().string();
+
+			if (entry.is_directory(error))
+				watchDirectory(name, changed);
+			else if (changed != nullptr)
+				changed->insert(name);
+		}
+	}
+
+	void AssetManager::watchThreadEntry()
+	{
+		std::set<std::string> changed;
+		std::chrono::steady_clock::time_point deadline;
+
+		alignas(struct inotify_event) char buffer[4096];
+
+		while (true)
+		{
+			int timeout = -1;
+			if (!changed.empty())
+				timeout = static_cast<int>(std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count()));
+
+			pollfd fds[2] = {
+				{ watchFd_, POLLIN, 0 },
+				{ watchWakeFd_, POLLIN, 0 },
+			};
+
+			if (poll(fds, 2, timeout) < 0)
+			{
+				if (errno == EINTR)
+					continue;
+
+				ENGINE_LOG_WARN(ASSET, "Asset watcher stopped, poll failed!");
+				return;
+			}
+
+			if (fds[1].revents & POLLIN)
+				return;
+
+			if (fds[0].revents & POLLIN)
+			{
+				ssize_t length;
+				while ((length = read(watchFd_, buffer, sizeof(buffer))) > 0)
+				{
+					for (char* position = buffer; position < buffer + length;)
+					{
+						const inotify_event* event = reinterpret_cast<const inotify_event*>(position);
+						position += sizeof(inotify_event) + event->len;
+
+						if (event->mask & IN_Q_OVERFLOW)
+						{
+							ENGINE_LOG_WARN(ASSET, "Asset watcher overflowed, some changes were missed!");
+							continue;
+						}
+
+						auto watched = watchedDirs_.find(event->wd);
+						if (watched == watchedDirs_.end())
+							continue;
+
+						if (event->mask & IN_IGNORED)
+						{
+							watchedDirs_.erase(watched);
+							continue;
+						}
+
+						if (event->len == 0)
+							continue;
+
+						std::string_view name(event->name);
+						std::string path = watched->second.empty() ? std::string(name) : watched->second + "/" + std::string(name);
+
+						if (event->mask & IN_ISDIR)
+						{
+							if (event->mask & (IN_CREATE | IN_MOVED_TO))
+								watchDirectory(path, &changed);
+							continue;
+						}
+
+						// files show up with IN_CREATE before they are written, IN_CLOSE_WRITE follows
+						if ((event->mask & IN_CREATE) || name.ends_with(".tmp"))
+							continue;
+
+						changed.insert(std::move(path));
+					}
+				}
+
+				deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(ENGINE_ASSET_RELOAD_DEBOUNCE_MS);
+			}
+
+			if (changed.empty() || std::chrono::steady_clock::now() < deadline)
+				continue;
+
+			std::vector<std::string> assetPaths(changed.begin(), changed.end());
+			changed.clear();
+
+			for (const std::string& assetPath : assetPaths)
+			{
+				invalidate(assetPath.c_str());
+				ENGINE_LOG_VERBOSE(ASSET, "Asset ", assetPath, " changed");
+			}
+
+			ENGINE_LOG_INFO(ASSET, "Reloading ", assetPaths.size(), " changed assets");
+
+			if (std::find(assetPaths.begin(), assetPaths.end(), AssetDependencies::fileName) != assetPaths.end())
+				loadDependencies();
+
+			std::lock_guard<std::mutex> lock(reloadMutex_);
+			for (ReloadListener& listener : reloadListeners_)
+				listener(assetPaths);
+		}
+	}
+
+	AssetHandle AssetManager::loadAsync(const char* assetPath, JobSystem::JobPriority priority)
+	{
+		bool isNew;
+		std::shared_ptr<AssetHandle::State> state = acquireCached(assetPath, priority, &isNew);
+
+		if (!isNew)
+			return AssetHandle(state);
+
+		// already mapped, nothing left for the I/O threads to do unless it still has to be decompressed
+		AssetView view;
+		if (findInArchive(assetPath, view) && !BlockCompression::isCompressed(view.data(), view.size()))
+		{
+			finishLoad(state, true, std::move(view));
+			return AssetHandle(state);
+		}
+
+		bool isQueued = false;
+
+		{
+			std::lock_guard<std::mutex> lock(ioMutex_);
+
+			if (isIoRunning_)
+			{
+				ioQueues_[static_cast<size_t>(priority)].push(state);
+				isQueued = true;
+			}
+		}
+
+		if (!isQueued)
+		{
+			ENGINE_LOG_WARN(ASSET, "Could not queue asset ", assetPath, ", the I/O threads are not running!");
+			finishLoad(state, false, AssetView());
+			return AssetHandle(state);
+		}
+
+		ioCv_.notify_one();
+		return AssetHandle(state);
+	}
+
+
+	namespace
+	{
+		/* owns a read only file mapping, shared by every view into it */
+		struct Mapping
+		{
+			void* address;
+			size_t size;
+
+			Mapping(void* address, size_t size) : address(address), size(size) {}
+			~Mapping() { munmap(address, size); }
+		};
+
+		/* blocks are claimed one at a time by the loading thread and by jobs, whoever is free first */
+		struct Decompression
+		{
+			const char* data = nullptr;
+			char* out = nullptr;
+			BlockCompression::Header header = {};
+			std::vector<uint64_t> blockOffsets;
+			std::atomic<uint32_t> nextBlock = 0;
+			std::atomic<uint32_t> finishedBlocks = 0;
+			std::atomic<bool> isCorrupted = false;
+		};
+
+		void decompressBlocks(Decompression& decompression)
+		{
+			uint32_t blockCount = decompression.header.blockCount;
+
+			// a job that starts after every block was claimed returns without touching data or out
+			for (uint32_t i = decompression.nextBlock.fetch_add(1); i < blockCount; i = decompression.nextBlock.fetch_add(1))
+			{
+				char* out = decompression.out + static_cast<size_t>(i) * decompression.header.blockSize;
+				if (!BlockCompression::decompressBlockAt(decompression.data, decompression.header, decompression.blockOffsets, i, out))
+					decompression.isCorrupted.store(true);
+
+				if (decompression.finishedBlocks.fetch_add(1, std::memory_order::acq_rel) + 1 == blockCount)
+					decompression.finishedBlocks.notify_all();
+			}
+		}
+
+		JOB(decompressBlocksJob)
+		{
+			auto decompression = static_cast<std::shared_ptr<Decompression>*>(arg);
+			decompressBlocks(**decompression);
+			delete decompression;
+			JOB_RETURN;
+		}
+
+		/** @returns false with errno set if the file could not be opened or mapped */
+		bool mapPath(const char* path, AssetView& view, bool populate)
+		{
+			int fd = open(path, O_RDONLY | O_CLOEXEC);
+			if (fd < 0)
+				return false;
+
+			struct stat status;
+			if (fstat(fd, &status) != 0)
+			{
+				int error = errno;
+				close(fd);
+				errno = error;
+				return false;
+			}
+
+			size_t size = static_cast<size_t>(status.st_size);
+
+			// mmap rejects empty ranges, an empty asset is still a valid one
+			if (size == 0)
+			{
+				close(fd);
+				view = AssetView(nullptr, "", 0);
+				return true;
+			}
+
+			// the mapping stays valid after closing the descriptor
+			void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | (populate ? MAP_POPULATE : 0), fd, 0);
+			int error = errno;
+			close(fd);
+
+			if (address == MAP_FAILED)
+			{
+				errno = error;
+				return false;
+			}
+
+			auto mapping = std::make_shared<Mapping>(address, size);
+			view = AssetView(std::shared_ptr<const void>(mapping, address), static_cast<const char*>(address), size);
+			return true;
+		}
+
+		/** @returns false with errno set if the file could not be opened or read, a file cut short while reading is returned as far as it got */
+		bool copyPath(const char* path, AssetView& view)
+		{
+			int fd = open(path, O_RDONLY | O_CLOEXEC);
+			if (fd < 0)
+				return false;
+
+			struct stat status;
+			if (fstat(fd, &status) != 0)
+			{
+				int error = errno;
+				close(fd);
+				errno = error;
+				return false;
+			}
+
+			size_t size = static_cast<size_t>(status.st_size);
+			std::shared_ptr<char[]> buffer(new (std::nothrow) char[std::max<size_t>(size, 1)]);
+			if (buffer == nullptr)
+			{
+				close(fd);
+				errno = ENOMEM;
+				return false;
+			}
+
+			size_t filled = 0;
+			while (filled < size)
+			{
+				ssize_t result = pread(fd, buffer.get() + filled, size - filled, static_cast<off_t>(filled));
+				if (result < 0 && errno == EINTR)
+					continue;
+
+				if (result < 0)
+				{
+					int error = errno;
+					close(fd);
+					errno = error;
+					return false;
+				}
+
+				if (result == 0)
+					break;
+
+				filled += static_cast<size_t>(result);
+			}
+
+			close(fd);
+
+			view = AssetView(std::shared_ptr<const void>(buffer, buffer.get()), buffer.get(), filled);
+			return true;
+		}
+	}
+
+	bool AssetManager::mountArchive(const std::string& archivePath)
+	{
+		AssetView archive;
+		if (!mapPath(archivePath.c_str(), archive, false))
+			return false;
+
+		if (!AssetArchive::validate(archive.data(), archive.size()))
+		{
+			ENGINE_LOG_WARN(ASSET, "Asset archive ", archivePath, " is corrupted or of another version!");
+			return false;
+		}
+
+		// lookups hit the table right away, the file data is still faulted in on access
+		madvise(const_cast<char*>(archive.data()), reinterpret_cast<const AssetArchive::Header*>(archive.data())->dataOffset, MADV_WILLNEED);
+
+		archive_ = std::move(archive);
+		archivePath_ = archivePath;
+
+		ENGINE_LOG_INFO(ASSET, "Mounted asset archive ", archivePath, " with ", reinterpret_cast<const AssetArchive::Header*>(archive_.data())->entryCount, " assets");
+		return true;
+	}
+
+	void AssetManager::loadDependencies()
+	{
+		AssetDependencies::Graph dependencies;
+
+		AssetView view;
+		if (fileExists(AssetDependencies::fileName) && mapAsset(AssetDependencies::fileName, view, false))
+			AssetDependencies::parse(view.text(), dependencies);
+
+		ENGINE_LOG_VERBOSE(ASSET, "Loaded the dependencies of ", dependencies.size(), " assets");
+
+		std::lock_guard<std::mutex> lock(dependenciesMutex_);
+		dependencies_ = std::move(dependencies);
+	}
+
+	void AssetManager::preload(const char* assetPath, std::vector<AssetHandle>& handles, JobSystem::JobPriority priority)
+	{
+		std::vector<std::string> closure;
+		std::unordered_set<std::string> visited;
+
+		{
+			std::lock_guard<std::mutex> lock(dependenciesMutex_);
+
+			// breadth first, assets closer to the root are queued first, cycles between scripts are visited once
+			closure.push_back(std::filesystem::path(assetPath).lexically_normal().generic_string());
+			visited.insert(closure.front());
+
+			for (size_t i = 0; i < closure.size(); i++)
+			{
+				auto dependencies = dependencies_.find(closure[i]);
+				if (dependencies == dependencies_.end())
+					continue;
+
+				for (const std::string& dependency : dependencies->second)
+					if (visited.insert(dependency).second)
+						closure.push_back(dependency);
+			}
+		}
+
+		handles.reserve(handles.size() + closure.size());
+
+		for (const std::string& path : closure)
+			handles.push_back(loadAsync(path.c_str(), priority));
+
+		ENGINE_LOG_VERBOSE(ASSET, "Preloading ", assetPath, " with ", closure.size() - 1, " dependencies");
+	}
+
+	bool AssetManager::findInArchive(const char* assetPath, AssetView& view)
+	{
+		if (archive_.empty())
+			return false;
+
+		std::string_view path(assetPath);
+		while (path.starts_with("./"))
+			path.remove_prefix(2);
+
+		const AssetArchive::Entry* entry = AssetArchive::find(archive_.data(), path);
+		if (entry == nullptr || entry->offset > archive_.size() || entry->size > archive_.size() - entry->offset)
+			return false;
+
+		view = archive_.subview(entry->offset, entry->size);
+		return true;
+	}
+
+	bool AssetManager::mapFile(const char* assetPath, AssetView& view)
+	{
+		bool isNew;
+		AssetHandle asset(acquireCached(assetPath, JobSystem::JobPriority::NORMAL, &isNew));
+
+		if (isNew)
+		{
+			AssetView mapped;
+			bool isLoaded = mapAsset(assetPath, mapped, false);
+			finishLoad(asset.state_, isLoaded, std::move(mapped));
+		}
+
+		// joins a load of the I/O threads if one is running
+		if (!asset.wait())
+			return false;
+
+		view = asset.view();
+		return true;
+	}
+
+	bool AssetManager::mapAsset(const char* assetPath, AssetView& view, bool populate)
+	{
+		if (!findInArchive(assetPath, view))
+		{
+			std::string path = createAbsolutePath(assetPath);
+
+			// a watched file is rewritten in place by editors, through a mapping that would change old views or fault past its new end
+			bool isCopied = isWatching_.load(std::memory_order::acquire);
+
+			if (!(isCopied ? copyPath(path.c_str(), view) : mapPath(path.c_str(), view, populate)))
+			{
+				if (errno == ENOENT)
+					ENGINE_LOG_WARN(ASSET, "Could not find asset ", assetPath, "!");
+				else
+					ENGINE_LOG_WARN(ASSET, "Could not map asset ", assetPath, "!");
+				return false;
+			}
+
+			ENGINE_LOG_VERBOSE(ASSET, isCopied ? "Copied file " : "Mapped file ", path, " (", view.size(), " bytes)");
+		}
+
+		if (BlockCompression::isCompressed(view.data(), view.size()))
+			return decompress(assetPath, view);
+
+		return true;
+	}
+
+	bool AssetManager::decompress(const char* assetPath, AssetView& view)
+	{
+		auto decompression = std::make_shared<Decompression>();
+		BlockCompression::Header& header = decompression->header;
+
+		if (!BlockCompression::readLayout(view.data(), view.size(), header, decompression->blockOffsets))
+		{
+			ENGINE_LOG_WARN(ASSET, "Compressed asset ", assetPath, " is corrupted or of another version!");
+			return false;
+		}
+
+		// not zero filled, every byte is written by a block
+		std::shared_ptr<char[]> buffer(new (std::nothrow) char[std::max<uint64_t>(header.rawSize, 1)]);
+		if (buffer == nullptr)
+		{
+			ENGINE_LOG_WARN(ASSET, "Could not allocate ", header.rawSize, " bytes to decompress ", assetPath, "!");
+			return false;
+		}
+
+		decompression->data = view.data();
+		decompression->out = buffer.get();
+
+		// the calling thread decompresses too, so this also finishes while the scheduler is not running (yet)
+		JobSystem::JobScheduler& scheduler = engine()->jobScheduler;
+		size_t helpers = std::min<size_t>(header.blockCount > 0 ? header.blockCount - 1 : 0, std::thread::hardware_concurrency());
+
+		if (helpers > 0 && scheduler.isReady())
+		{
+			std::vector<JobSystem::JobInfo> jobs(helpers);
+			for (JobSystem::JobInfo& job : jobs)
+				job = { decompressBlocksJob, new std::shared_ptr<Decompression>(decompression), JobSystem::JobPriority::HIGH };
+
+			if (scheduler.runJobs(jobs.data(), jobs.size()) == nullptr)
+				for (JobSystem::JobInfo& job : jobs)
+					delete static_cast<std::shared_ptr<Decompression>*>(job.arg);
+		}
+
+		decompressBlocks(*decompression);
+
+		uint32_t finished = decompression->finishedBlocks.load(std::memory_order::acquire);
+		while (finished != header.blockCount)
+		{
+			decompression->finishedBlocks.wait(finished, std::memory_order::acquire);
+			finished = decompression->finishedBlocks.load(std::memory_order::acquire);
+		}
+
+		if (decompression->isCorrupted.load())
+		{
+			ENGINE_LOG_WARN(ASSET, "Compressed asset ", assetPath, " is corrupted!");
+			return false;
+		}
+
+		ENGINE_LOG_VERBOSE(ASSET, "Decompressed ", assetPath, " (", view.size(), " to ", header.rawSize, " bytes, ", header.blockCount, " blocks)");
+
+		view = AssetView(std::shared_ptr<const void>(buffer, buffer.get()), buffer.get(), header.rawSize);
+		return true;
+	}
+
+	bool AssetManager::openStream(const char* assetPath, AssetStream& stream, size_t chunkSize, size_t chunkCount)
+	{
+		// archived assets are read from their range of the archive file, not through its mapping
+		AssetView entry;
+		bool isArchived = findInArchive(assetPath, entry);
+		std::string path = isArchived ? archivePath_ : createAbsolutePath(assetPath);
+
+		int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+		{
+			if (errno == ENOENT)
+				ENGINE_LOG_WARN(ASSET, "Could not find asset ", assetPath, "!");
+			else
+				ENGINE_LOG_WARN(ASSET, "Could not open asset ", assetPath, "!");
+			return false;
+		}
+
+		uint64_t offset = 0;
+		uint64_t size = entry.size();
+
+		if (isArchived)
+		{
+			offset = static_cast<uint64_t>(entry.data() - archive_.data());
+		}
+		else
+		{
+			struct stat status;
+			if (fstat(fd, &status) != 0)
+			{
+				ENGINE_LOG_WARN(ASSET, "Could not open asset ", assetPath, "!");
+				close(fd);
+				return false;
+			}
+
+			size = static_cast<uint64_t>(status.st_size);
+		}
+
+		// every stream reads on a thread of its own, a reused stream gives its slot back first
+		stream.close();
+		if (openStreams_.fetch_add(1, std::memory_order::acq_rel) >= ENGINE_ASSET_MAX_STREAMS)
+		{
+			openStreams_.fetch_sub(1, std::memory_order::acq_rel);
+			ENGINE_LOG_WARN(ASSET, "Could not stream asset ", assetPath, ", ", ENGINE_ASSET_MAX_STREAMS, " streams are open already!");
+			close(fd);
+			return false;
+		}
+
+		stream.open(assetPath, fd, offset, size, chunkSize, chunkCount, &openStreams_);
+
+		ENGINE_LOG_VERBOSE(ASSET, "Streaming ", assetPath, " (", size, " bytes in chunks of ", chunkSize, ")");
+		return true;
+	}
+
+	bool AssetManager::loadFile(const char* assetPath, std::vector<char>& fileContents)
+	{
+		AssetView view;
+		if (!mapFile(assetPath, view))
+			return false;
+
+		// a single copy out of the page cache, no zero filled resize before reading
+		fileContents.assign(view.data(), view.data() + view.size());
+		return true;
 	}
 
 	bool AssetManager::loadTextFile(const char* assetPath, std::vector<char>& fileContents)
 	{
-		if(loadFile(assetPath, fileContents))
+		if (loadFile(assetPath, fileContents))
 		{
-			fileContents.resize(fileContents.size() + 1);
-			fileContents[fileContents.size()] = '\0';
+			fileContents.push_back('\0');
 			return true;
 		}
 		return false;
@@ -53,8 +1033,29 @@ namespace NovaEngine
 
 	bool AssetManager::fileExists(const char* assetPath)
 	{
+		AssetView view;
+		if (findInArchive(assetPath, view))
+			return true;
+
 		struct stat buffer;
 		std::string path = createAbsolutePath(assetPath);
 		return stat(path.c_str(), &buffer) == 0;
 	}
+
+	bool AssetManager::isModifiedAfter(const char* assetPath, const char* otherPath)
+	{
+		AssetView view;
+		if (findInArchive(assetPath, view) || findInArchive(otherPath, view))
+			return false;
+
+		struct stat status;
+		struct stat otherStatus;
+		if (stat(createAbsolutePath(assetPath).c_str(), &status) != 0 || stat(createAbsolutePath(otherPath).c_str(), &otherStatus) != 0)
+			return false;
+
+		if (status.st_mtim.tv_sec != otherStatus.st_mtim.tv_sec)
+			return status.st_mtim.tv_sec > otherStatus.st_mtim.tv_sec;
+
+		return status.st_mtim.tv_nsec > otherStatus.st_mtim.tv_nsec;
+	}
 }
@@ -0,0 +1,159 @@
+#include "AssetStream.hpp"
+#include "Logger.hpp"
+
+namespace NovaEngine
+{
+	AssetStream::Pool::~Pool()
+	{
+		if (fd >= 0)
+			::close(fd);
+	}
+
+	void AssetStream::Pool::read()
+	{
+		for (uint64_t position = 0; position < size;)
+		{
+			char* buffer;
+
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				cv.wait(lock, [&] { return isClosed || !freeBuffers.empty(); });
+
+				if (isClosed)
+					return;
+
+				buffer = freeBuffers.back();
+				freeBuffers.pop_back();
+			}
+
+			size_t length = static_cast<size_t>(std::min<uint64_t>(chunkSize, size - position));
+			size_t filled = 0;
+
+			// pread may return less than asked for, e.g. when interrupted by a signal
+			while (filled < length)
+			{
+				ssize_t result = pread(fd, buffer + filled, length - filled, static_cast<off_t>(offset + position + filled));
+				if (result < 0 && errno == EINTR)
+					continue;
+
+				if (result <= 0)
+					break;
+
+				filled += static_cast<size_t>(result);
+			}
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if (filled != length)
+			{
+				freeBuffers.push_back(buffer);
+				isFailed = true;
+				cv.notify_all();
+				return;
+			}
+
+			chunks.push({ buffer, length });
+			position += length;
+			cv.notify_all();
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		isDone = true;
+		cv.notify_all();
+	}
+
+	void AssetStream::open(const char* path, int fd, uint64_t offset, uint64_t size, size_t chunkSize, size_t bufferCount, std::atomic<size_t>* openStreams)
+	{
+		close();
+
+		auto pool = std::make_shared<Pool>();
+		pool->fd = fd;
+		pool->offset = offset;
+		pool->size = size;
+		pool->chunkSize = std::max<size_t>(chunkSize, 1);
+
+		// never more buffers than chunks, small assets do not allocate the whole pool
+		uint64_t chunkCount = (size + pool->chunkSize - 1) / pool->chunkSize;
+		bufferCount = static_cast<size_t>(std::min<uint64_t>(std::max<size_t>(bufferCount, 1), std::max<uint64_t>(chunkCount, 1)));
+
+		for (size_t i = 0; i < bufferCount; i++)
+		{
+			pool->buffers.emplace_back(new char[pool->chunkSize]);
+			pool->freeBuffers.push_back(pool->buffers.back().get());
+		}
+
+		// the kernel reads further ahead for sequential access
+		posix_fadvise(fd, static_cast<off_t>(offset), static_cast<off_t>(size), POSIX_FADV_SEQUENTIAL);
+
+		pool_ = pool;
+		path_ = path;
+		openStreams_ = openStreams;
+		reader_ = std::thread([pool] { pool->read(); });
+	}
+
+	bool AssetStream::next(AssetView& chunk)
+	{
+		if (pool_ == nullptr)
+			return false;
+
+		Chunk next;
+
+		{
+			std::unique_lock<std::mutex> lock(pool_->mutex);
+			pool_->cv.wait(lock, [&] { return !pool_->chunks.empty() || pool_->isDone || pool_->isFailed || pool_->isClosed; });
+
+			if (pool_->chunks.empty())
+			{
+				if (pool_->isFailed)
+					ENGINE_LOG_WARN(ASSET, "Could not read asset stream ", path_, "!");
+				return false;
+			}
+
+			next = pool_->chunks.front();
+			pool_->chunks.pop();
+		}
+
+		// the token hands the buffer back to the reader once the last view of the chunk is gone
+		std::shared_ptr<Pool> pool = pool_;
+		std::shared_ptr<const void> token(next.buffer, [pool](const void* buffer) {
+			std::lock_guard<std::mutex> lock(pool->mutex);
+			pool->freeBuffers.push_back(static_cast<char*>(const_cast<void*>(buffer)));
+			pool->cv.notify_all();
+		});
+
+		chunk = AssetView(std::move(token), next.buffer, next.size);
+		return true;
+	}
+
+	void AssetStream::close()
+	{
+		if (pool_ == nullptr)
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock(pool_->mutex);
+			pool_->isClosed = true;
+		}
+
+		pool_->cv.notify_all();
+
+		if (reader_.joinable())
+			reader_.join();
+
+		// outstanding chunks keep the pool and its buffers alive
+		pool_.reset();
+
+		if (openStreams_ != nullptr)
+			openStreams_->fetch_sub(1, std::memory_order::acq_rel);
+		openStreams_ = nullptr;
+	}
+
+	bool AssetStream::isFailed()
+	{
+		if (pool_ == nullptr)
+			return false;
+
+		std::lock_guard<std::mutex> lock(pool_->mutex);
+		return pool_->isFailed;
+	}
+}
@@ -5,6 +5,7 @@
 #include "Engine.hpp"
 #include "ScriptManager.hpp"
 #include "GameWindow.hpp"
+#include "Logger.hpp"
 
 namespace NovaEngine
 {
@@ -83,7 +84,62 @@ namespace NovaEngine
 				engineConfig_.window.maximized = Parser::parseBool(windowObj, "maximized", true);
 				engineConfig_.window.hidden = Parser::parseBool(windowObj, "hidden", false);
 			}
+
+			engineConfig_.jobs.minWorkers = 1;
+			engineConfig_.jobs.maxWorkers = 0;
+
+			if (!Parser::isUndefined(config, "jobs"))
+			{
+				Local<Object> jobsObj = Parser::parseObj(config, "jobs");
+				engineConfig_.jobs.minWorkers = Parser::parseUint(jobsObj, "minWorkers", 1);
+				engineConfig_.jobs.maxWorkers = Parser::parseUint(jobsObj, "maxWorkers", 0);
+			}
+
+			// "assets": { "cacheBudget": 256, "hotReload": true } cacheBudget in megabytes
+			engineConfig_.assets.cacheBudget = ENGINE_ASSET_CACHE_BUDGET;
+			engineConfig_.assets.hotReload = false;
+			engineConfig_.assets.recordPrefetch = false;
+
+			if (!Parser::isUndefined(config, "assets"))
+			{
+				Local<Object> assetsObj = Parser::parseObj(config, "assets");
+				engineConfig_.assets.cacheBudget = static_cast<size_t>(Parser::parseUint(assetsObj, "cacheBudget", ENGINE_ASSET_CACHE_BUDGET / (1024 * 1024))) * 1024 * 1024;
+				engineConfig_.assets.hotReload = Parser::parseBool(assetsObj, "hotReload", false);
+				engineConfig_.assets.recordPrefetch = Parser::parseBool(assetsObj, "recordPrefetch", false);
+			}
 			
+			// "log": { "level": "info", "categories": { "jobs": "verbose" } }
+			LogFormat::Severity logLevel = LogFormat::Severity::INFO;
+			Local<Object> logCategoriesObj;
+
+			if (!Parser::isUndefined(config, "log"))
+			{
+				Local<Object> logObj = Parser::parseObj(config, "log");
+				std::string level = Parser::parseString(logObj, "level", "info");
+
+				if (!LogFormat::parseSeverity(level, &logLevel))
+					ENGINE_LOG_WARN(GENERAL, "Unknown log level ", level, "!");
+
+				if (!Parser::isUndefined(logObj, "categories"))
+					logCategoriesObj = Parser::parseObj(logObj, "categories");
+			}
+
+			for (size_t i = 0; i < static_cast<size_t>(LogFormat::Category::COUNT); i++)
+			{
+				LogFormat::Severity& severity = engineConfig_.log.severities[i];
+				severity = logLevel;
+
+				std::string name = LogFormat::categoryName(static_cast<LogFormat::Category>(i));
+				std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+				if (!logCategoriesObj.IsEmpty() && !Parser::isUndefined(logCategoriesObj, name.c_str()))
+				{
+					std::string level = Parser::parseString(logCategoriesObj, name.c_str());
+					if (!LogFormat::parseSeverity(level, &severity))
+						ENGINE_LOG_WARN(GENERAL, "Unknown log level ", level, " for ", name, "!");
+				}
+			}
+
 			ScriptManager::printObject(config->CreationContext()->GetIsolate(), config, "config");
 			isConfigured_ = true;			
 			return true;
@@ -95,7 +151,7 @@ namespace NovaEngine
 	bool ConfigManager::onInitialize(v8::Global<v8::Object>* config)
 	{
 		if (!isConfigured_)
-			engine()->scriptManager.run([&](ScriptManager::RunInfo& info) {
+			engine()->scriptManager.runLocked([&](ScriptManager::RunInfo& info) {
 				isConfigured_ = parseConfigObject(config->Get(info.isolate)->ToObject(info.isolate));
 			});
 		
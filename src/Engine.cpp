@@ -40,19 +40,113 @@ namespace NovaEngine
 			}
 		}
 
+		// copies an external one-byte string as long as it is plain ascii, everything else goes through WriteUtf8
+		bool copyExternalAscii(const v8::Local<v8::String>& str, char* out, size_t capacity, size_t* written)
+		{
+			v8::String::Encoding encoding;
+			const v8::String::ExternalStringResourceBase* resource = str->GetExternalStringResourceBase(&encoding);
+			if (resource == nullptr || encoding != v8::String::ONE_BYTE_ENCODING)
+				return false;
+
+			const v8::String::ExternalOneByteStringResource* oneByte = static_cast<const v8::String::ExternalOneByteStringResource*>(resource);
+			const char* data = oneByte->data();
+			size_t length = std::min(oneByte->length(), capacity);
+
+			for (size_t i = 0; i < length; i++)
+			{
+				if (static_cast<unsigned char>(data[i]) >= 0x80)
+					return false;
+				out[i] = data[i];
+			}
+
+			*written = length;
+			return true;
+		}
+
+		// a script logging in a loop is folded and rate limited per call site (script name and line) like ENGINE_LOG,
+		// only used while the isolate mutex is held, the sites stay registered with the logger so they are never freed
+		Logger::Site& scriptLogSite(v8::Isolate* isolate)
+		{
+			static std::unordered_map<std::string, Logger::Site>* sites = new std::unordered_map<std::string, Logger::Site>();
+			static std::string key;
+
+			key.clear();
+
+			v8::Local<v8::StackTrace> trace = v8::StackTrace::CurrentStackTrace(isolate, 1, v8::StackTrace::kOverview);
+			if (trace->GetFrameCount() > 0)
+			{
+				v8::Local<v8::StackFrame> frame = trace->GetFrame(0);
+				v8::Local<v8::String> scriptName = frame->GetScriptName();
+				if (!scriptName.IsEmpty())
+				{
+					key.resize(scriptName->Utf8Length());
+					scriptName->WriteUtf8(key.data(), static_cast<int>(key.size()), nullptr, v8::String::NO_NULL_TERMINATION);
+				}
+				key += ':';
+				key += std::to_string(frame->GetLineNumber());
+			}
+
+			auto site = sites->find(key);
+			if (site == sites->end())
+				site = sites->try_emplace(key).first;
+			return site->second;
+		}
+
 		SCRIPT_METHOD(log)
 		{
+			constexpr char prefix[] = "[Game] ";
+			constexpr size_t prefixLength = sizeof(prefix) - 1;
+			constexpr size_t inlineArgs = 8;
+
+			if (!Logger::isEnabled(LogFormat::Category::SCRIPT, LogFormat::Severity::INFO))
+				return;
+
 			v8::Isolate* isolate = args.GetIsolate();
-			std::string buf = "[Game] ";
-			for (int i = 0; i < args.Length(); i++)
+			int count = args.Length();
+
+			// converted before the record is reserved, toString() of an object may log itself
+			v8::Local<v8::String> inlineStrings[inlineArgs];
+			std::vector<v8::Local<v8::String>> heapStrings;
+			v8::Local<v8::String>* strings = inlineStrings;
+			if (count > static_cast<int>(inlineArgs))
+			{
+				heapStrings.resize(count);
+				strings = heapStrings.data();
+			}
+
+			size_t maxLength = prefixLength;
+			for (int i = 0; i < count; i++)
+			{
+				strings[i] = args[i]->ToString(isolate);
+				maxLength += strings[i]->Length() * 3 + 2; // worst case utf-8 size and the separator
+			}
+
+			Logger::Site& logSite = scriptLogSite(isolate);
+			Logger* logger = Logger::get();
+			char* out = logger->beginText(LogFormat::Category::SCRIPT, LogFormat::Severity::INFO, &maxLength);
+			if (out == nullptr)
+				return;
+
+			size_t length = std::min(prefixLength, maxLength);
+			memcpy(out, prefix, length);
+
+			for (int i = 0; i < count && length < maxLength; i++)
 			{
-				auto a = args[i]->ToString(isolate);
-				v8::String::Utf8Value val(a);
-				buf += *val;
-				if (i != args.Length() - 1)
-					buf += ", ";
+				if (i != 0)
+				{
+					size_t separatorLength = std::min<size_t>(2, maxLength - length);
+					memcpy(out + length, ", ", separatorLength);
+					length += separatorLength;
+				}
+
+				size_t written;
+				if (!copyExternalAscii(strings[i], out + length, maxLength - length, &written))
+					written = strings[i]->WriteUtf8(out + length, static_cast<int>(maxLength - length), nullptr, v8::String::NO_NULL_TERMINATION | v8::String::REPLACE_INVALID_UTF8);
+
+				length += written;
 			}
-			Logger::get()->info(buf);
+
+			logger->commitText(logSite, length);
 		}
 
 		// the game will call this to configure the engine
@@ -81,12 +175,206 @@ namespace NovaEngine
 			engine->start();
 		}
 
+		SCRIPT_METHOD(onReportLocks)
+		{
+			LockProfiler::logReport();
+		}
+
+		SCRIPT_METHOD(onReportAssets)
+		{
+			Engine* engine = ScriptManager::fetchEngineFromArgs(args);
+			engine->assetManager.logCacheStats();
+		}
+
+		// Engine.setLogLevel(level, category?) without a category sets every category
+		SCRIPT_METHOD(onSetLogLevel)
+		{
+			v8::Isolate* isolate = args.GetIsolate();
+
+			if (args.Length() < 1)
+			{
+				ENGINE_LOG_WARN(SCRIPT, "Engine.setLogLevel expects a level!");
+				return;
+			}
+
+			v8::String::Utf8Value level(args[0]->ToString(isolate));
+			LogFormat::Severity severity;
+
+			if (!LogFormat::parseSeverity(*level, &severity))
+			{
+				ENGINE_LOG_WARN(SCRIPT, "Unknown log level ", *level, "!");
+				return;
+			}
+
+			if (args.Length() < 2 || args[1]->IsUndefined())
+			{
+				Logger::setSeverity(severity);
+				return;
+			}
+
+			v8::String::Utf8Value categoryName(args[1]->ToString(isolate));
+			LogFormat::Category category;
+
+			if (!LogFormat::parseCategory(*categoryName, &category))
+			{
+				ENGINE_LOG_WARN(SCRIPT, "Unknown log category ", *categoryName, "!");
+				return;
+			}
+
+			Logger::setSeverity(category, severity);
+		}
+
 		SCRIPT_METHOD(onShowWindow)
 		{
 			Engine* engine = ScriptManager::fetchEngineFromArgs(args);
 			engine->gameWindow.show();
 		}
 
+		struct LoadTextRequest
+		{
+			AssetHandle asset;
+			v8::Global<v8::Promise::Resolver> resolver;
+		};
+
+		// waits for the I/O threads and settles the promise of Engine.loadText once the isolate is free
+		JOB(resolveLoadText)
+		{
+			LoadTextRequest* request = static_cast<LoadTextRequest*>(arg);
+
+			bool isLoaded = co_await request->asset;
+
+			co_await engine->scriptManager.isolateMutex().lock();
+
+			engine->scriptManager.run([&](const ScriptManager::RunInfo& runInfo) {
+				v8::Local<v8::Promise::Resolver> resolver = request->resolver.Get(runInfo.isolate);
+
+				if (isLoaded)
+				{
+					AssetView view = request->asset.view();
+					v8::Local<v8::String> text = v8::String::NewFromUtf8(runInfo.isolate, view.empty() ? "" : view.data(), v8::NewStringType::kNormal, static_cast<int>(view.size())).ToLocalChecked();
+					resolver->Resolve(text);
+				}
+				else
+				{
+					std::string message = "Could not load asset " + request->asset.path() + "!";
+					resolver->Reject(v8::String::NewFromUtf8(runInfo.isolate, message.c_str(), v8::NewStringType::kNormal).ToLocalChecked());
+				}
+
+				// nothing else is on the stack to run the then callbacks
+				runInfo.isolate->RunMicrotasks();
+				request->resolver.Reset();
+			});
+
+			engine->scriptManager.isolateMutex().unlock();
+
+			delete request;
+			JOB_RETURN;
+		}
+
+		// Engine.loadText(path) reads the asset on the I/O threads and resolves with its content
+		SCRIPT_METHOD(onLoadText)
+		{
+			v8::Isolate* isolate = args.GetIsolate();
+			Engine* engine = ScriptManager::fetchEngineFromArgs(args);
+
+			v8::Local<v8::Promise::Resolver> resolver = v8::Promise::Resolver::New(isolate);
+			args.GetReturnValue().Set(resolver->GetPromise());
+
+			if (args.Length() < 1)
+			{
+				resolver->Reject(v8::String::NewFromUtf8(isolate, "Engine.loadText expects a path!", v8::NewStringType::kNormal).ToLocalChecked());
+				return;
+			}
+
+			v8::String::Utf8Value path(args[0]->ToString(isolate));
+
+			LoadTextRequest* request = new LoadTextRequest();
+			request->asset = engine->assetManager.loadAsync(*path);
+			request->resolver.Reset(isolate, resolver);
+
+			if (engine->jobScheduler.runJob({ resolveLoadText, request, JobSystem::JobPriority::NORMAL }) == nullptr)
+			{
+				resolver->Reject(v8::String::NewFromUtf8(isolate, "Engine.loadText was rejected by the job system!", v8::NewStringType::kNormal).ToLocalChecked());
+				request->resolver.Reset();
+				delete request;
+			}
+		}
+
+		struct ReloadScriptRequest
+		{
+			std::string path; // relative to the scripts directory, like the module keys
+			bool isJsonModule;
+		};
+
+		/* module keys with a reload job that has not started yet, e.g. x.json and x.json.js changing together reload x.json once */
+		std::mutex pendingReloadsMutex_;
+		std::unordered_set<std::string> pendingReloads_;
+
+		JOB(reloadScript)
+		{
+			ReloadScriptRequest* request = static_cast<ReloadScriptRequest*>(arg);
+
+			co_await engine->scriptManager.isolateMutex().lock();
+
+			// changes from now on need another reload, this one may already have read the file
+			{
+				std::lock_guard<std::mutex> lock(pendingReloadsMutex_);
+				pendingReloads_.erase(request->path);
+			}
+
+			if (engine->scriptManager.reload(request->path.c_str(), request->isJsonModule))
+				ENGINE_LOG_INFO(SCRIPT, "Reloaded module ", request->path);
+
+			engine->scriptManager.isolateMutex().unlock();
+
+			delete request;
+			JOB_RETURN;
+		}
+
+		// hot reload listener, scripts that were never required are picked up by their first require
+		void onAssetsChanged(Engine* engine, const std::vector<std::string>& assetPaths)
+		{
+			constexpr std::string_view scriptsDir = "scripts/";
+			constexpr std::string_view cookedJsonExtension = ".json.js";
+
+			for (const std::string& assetPath : assetPaths)
+			{
+				std::string_view path(assetPath);
+				if (!path.starts_with(scriptsDir) || !engine->assetManager.fileExists(assetPath.c_str()))
+					continue;
+
+				path.remove_prefix(scriptsDir.size());
+
+				ReloadScriptRequest* request;
+				if (path.ends_with(cookedJsonExtension))
+					request = new ReloadScriptRequest{ std::string(path.substr(0, path.size() - 3)), true };
+				else if (path.ends_with(".json"))
+					request = new ReloadScriptRequest{ std::string(path), true };
+				else if (path.ends_with(".js"))
+					request = new ReloadScriptRequest{ std::string(path), false };
+				else
+					continue;
+
+				{
+					std::lock_guard<std::mutex> lock(pendingReloadsMutex_);
+					if (!pendingReloads_.insert(request->path).second)
+					{
+						delete request;
+						continue;
+					}
+				}
+
+				if (engine->jobScheduler.runJob({ reloadScript, request, JobSystem::JobPriority::NORMAL }) == nullptr)
+				{
+					ENGINE_LOG_WARN(SCRIPT, "Could not reload module ", request->path, ", rejected by the job system!");
+
+					std::lock_guard<std::mutex> lock(pendingReloadsMutex_);
+					pendingReloads_.erase(request->path);
+					delete request;
+				}
+			}
+		}
+
 		static void globalInitializer(ScriptManager* manager, const v8::Local<v8::Object>& o)
 		{
 			v8::Isolate* isolate = manager->isolate();
@@ -97,6 +385,10 @@ namespace NovaEngine
 			engineObj->Set(ctx, manager->createString("onLoad"), manager->createFunction(onEngineLoad));
 			engineObj->Set(ctx, manager->createString("log"), manager->createFunction(log));
 			engineObj->Set(ctx, manager->createString("start"), manager->createFunction(onEngineStart));
+			engineObj->Set(ctx, manager->createString("reportLocks"), manager->createFunction(onReportLocks));
+			engineObj->Set(ctx, manager->createString("reportAssets"), manager->createFunction(onReportAssets));
+			engineObj->Set(ctx, manager->createString("setLogLevel"), manager->createFunction(onSetLogLevel));
+			engineObj->Set(ctx, manager->createString("loadText"), manager->createFunction(onLoadText));
 
 			v8::Local<v8::Object> windowObj = v8::Object::New(isolate);
 			windowObj->Set(ctx, manager->createString("show"), manager->createFunction(onShowWindow));
@@ -145,24 +437,38 @@ namespace NovaEngine
 	{
 		Logger::get()->info("Initializing Engine...");
 
+		std::string flightRecorderPath = Utils::Path::combine(executablePath(), "logs", "crash-" + std::to_string(time(nullptr)) + ".nlg");
+		if (!FlightRecorder::install(flightRecorderPath.c_str()))
+			Logger::get()->warn("Could not install the crash handlers of the flight recorder!");
+
 		CHECK(initSubSystem("Asset manager", &assetManager, executablePath()), "Failed to initialize Asset Manager!");
 		CHECK(initSubSystem("Script Manager", &scriptManager, globalInitializer), "Failed to initialie Script Manager!");
 
-		scriptManager.load(gameStartupScript == nullptr ? "Game.js" : gameStartupScript);
+		const char* startupScript = gameStartupScript == nullptr ? "Game.js" : gameStartupScript;
+
+		// every module the startup script requires is read in parallel instead of one require at a time
+		{
+			std::vector<AssetHandle> startupAssets;
+			assetManager.preload(Utils::Path::combine("scripts", startupScript).string().c_str(), startupAssets);
+
+			scriptManager.lockIsolate();
+			scriptManager.load(startupScript);
+			scriptManager.isolateMutex().unlock();
+		}
 		if (onLoadCallback_.IsEmpty())
 			return false;
 
 		bool configInitialized = false;
 
 		// call Engine.onLoad() to provide a configure callback
-		scriptManager.run([&](const ScriptManager::RunInfo& runInfo) {
+		scriptManager.runLocked([&](const ScriptManager::RunInfo& runInfo) {
 			v8::Local<v8::Object> recv = v8::Object::New(runInfo.isolate);
 			v8::Local<v8::Value> argv[] = { v8::Function::New(runInfo.isolate, onEngineConfigure) };
 			onLoadCallback_.Get(runInfo.isolate)->Call(recv, 1, argv)->ToObject(runInfo.isolate);
 		});
 
 		auto rejectGameConfig = [&](const char* message) {
-			scriptManager.run([&](const ScriptManager::RunInfo& runInfo) {
+			scriptManager.runLocked([&](const ScriptManager::RunInfo& runInfo) {
 				v8::Local<v8::String> reason = v8::String::NewFromUtf8(runInfo.isolate, message, v8::NewStringType::kNormal).ToLocalChecked();
 				configurePromiseResolver_.Get(runInfo.isolate)->Reject(reason);
 			});
@@ -175,6 +481,9 @@ namespace NovaEngine
 
 		CHECK_REJECT(configInitialized, rejectGameConfig, "Could not initialize Config Manager!");
 
+		for (size_t i = 0; i < static_cast<size_t>(LogFormat::Category::COUNT); i++)
+			Logger::setSeverity(static_cast<LogFormat::Category>(i), configManager.getConfig()->log.severities[i]);
+
 		CHECK_REJECT(gameWindow.create(configManager.getConfig()->name.c_str(), configManager.getConfig()->window), rejectGameConfig, "Could not create Game Window!");
 
 		Graphics::GraphicsConfig config = {};
@@ -183,6 +492,19 @@ namespace NovaEngine
 
 		CHECK_REJECT(jobScheduler.initialize(10000, std::thread::hardware_concurrency() - 1), rejectGameConfig, "Could not initialize Job System!");
 
+		jobScheduler.setWorkerLimits(configManager.getConfig()->jobs.minWorkers, configManager.getConfig()->jobs.maxWorkers);
+
+		assetManager.setCacheBudget(configManager.getConfig()->assets.cacheBudget);
+
+		// the startup script was already recorded, the config only decides whether the record is kept
+		assetManager.setPrefetchRecording(configManager.getConfig()->assets.recordPrefetch);
+
+		if (configManager.getConfig()->assets.hotReload)
+		{
+			assetManager.addReloadListener([this](const std::vector<std::string>& assetPaths) { onAssetsChanged(this, assetPaths); });
+			assetManager.watch();
+		}
+
 		Graphics::SwapChainOptions scOptions = {
 			.vSyncEnabled = true,
 			.minFrames = 3,
@@ -226,7 +548,7 @@ namespace NovaEngine
 	{
 		if (!configurePromiseResolver_.IsEmpty()) // probably first time started (with configuration passed) 
 		{
-			scriptManager.run([](const ScriptManager::RunInfo& runInfo) {
+			scriptManager.runLocked([](const ScriptManager::RunInfo& runInfo) {
 				configurePromiseResolver_.Get(runInfo.isolate)->Resolve(v8::Local<v8::Value>(v8::Undefined(runInfo.isolate)));
 			});
 			configurePromiseResolver_.Reset();
@@ -241,7 +563,10 @@ namespace NovaEngine
 	JOB(pollEvents)
 	{
 		glfwPollEvents();
-		scheduler->runJob(pollEvents);
+
+		if (scheduler->runJob({ pollEvents, 0, JobSystem::JobPriority::HIGH }) == nullptr)
+			ENGINE_LOG_ERROR(JOBS, "pollEvents was rejected by the job system, window events are no longer polled!");
+
 		JOB_RETURN;
 	}
 
@@ -264,9 +589,19 @@ namespace NovaEngine
 				scheduler->execNext(); // lets execute the next job in the queue in the meanwhile 
 			});
 
-			scheduler->runJob({ engineLoop, w });
+			// the next frame has to be done by the next vsync of this window
+			JobSystem::JobDeadline deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(1000000 / w->refreshRate());
+			if (scheduler->runJob({ engineLoop, w, JobSystem::JobPriority::HIGH, reinterpret_cast<uintptr_t>(w), deadline }) == nullptr)
+			{
+				// nothing would present this window anymore, close it instead of leaving exec() waiting for it
+				ENGINE_LOG_ERROR(JOBS, "engineLoop was rejected by the job system, closing the window!");
+				engine->graphicsManager.destroyContext(ctx);
+				w->destroy();
+			}
 
-			std::cout << frames++ << std::endl;
+			ENGINE_FLIGHT_EVENT(GRAPHICS, "frame ", frames, " presented");
+			frames++;
+			ENGINE_LOG_VERBOSE(GRAPHICS, "Frame presented");
 		}
 		
 		JOB_RETURN;
@@ -298,12 +633,17 @@ namespace NovaEngine
 			win2->show();
 
 			JobSystem::JobInfo jobs[3] = {
-				{ pollEvents },
-				{ engineLoop, static_cast<void*>(&gameWindow) },
-				{ engineLoop, static_cast<void*>(win2) },
+				{ pollEvents, 0, JobSystem::JobPriority::HIGH },
+				{ engineLoop, static_cast<void*>(&gameWindow), JobSystem::JobPriority::HIGH, reinterpret_cast<uintptr_t>(&gameWindow) },
+				{ engineLoop, static_cast<void*>(win2), JobSystem::JobPriority::HIGH, reinterpret_cast<uintptr_t>(win2) },
 			};
 
-			jobScheduler.runJobs(jobs, 3);
+			if (jobScheduler.runJobs(jobs, 3) == nullptr)
+			{
+				Logger::get()->error("The engine loop was rejected by the job system!");
+				isRunning_ = false;
+				return;
+			}
 
 			jobScheduler.exec([&] { return !gameWindow.isClosed(); }, [&] {
 				// callback for each loop iteration
@@ -330,12 +670,18 @@ namespace NovaEngine
 		onLoadCallback_.Reset();
 		configuredValue_.Reset();
 
+		// reload listeners post jobs, failed loads resume the jobs awaiting them, both have to happen while jobs still run
+		assetManager.stopWatching();
+		assetManager.stopLoading();
+		jobScheduler.drain();
 		jobScheduler.terminate();
 		graphicsManager.terminate();
 		configManager.terminate();
 		scriptManager.terminate();
 		assetManager.terminate();
 
+		LockProfiler::logReport();
+
 		Logger::terminate();
 
 		glfwTerminate();
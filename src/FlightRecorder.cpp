@@ -0,0 +1,140 @@
+#include "FlightRecorder.hpp"
+#include "Logger.hpp"
+
+namespace NovaEngine
+{
+	FlightRecorder::Slot FlightRecorder::slots_[ENGINE_FLIGHT_RECORDER_SLOTS];
+	std::atomic<uint64_t> FlightRecorder::next_ = 0;
+	char FlightRecorder::dumpPath_[PATH_MAX];
+	std::atomic<bool> FlightRecorder::isDumping_ = false;
+
+	namespace
+	{
+		constexpr int crashSignals[] = { SIGSEGV, SIGABRT, SIGBUS, SIGFPE, SIGILL };
+
+		// big enough to still run the handler after a stack overflow
+		char alternateStack[64 * 1024];
+
+		void writeAll(int fd, const void* data, size_t size)
+		{
+			const char* bytes = static_cast<const char*>(data);
+			while (size > 0)
+			{
+				ssize_t written = write(fd, bytes, size);
+				if (written <= 0)
+				{
+					if (written < 0 && errno == EINTR)
+						continue;
+					return;
+				}
+				bytes += written;
+				size -= written;
+			}
+		}
+
+		size_t length(const char* str)
+		{
+			size_t i = 0;
+			while (str[i] != '\0')
+				i++;
+			return i;
+		}
+	}
+
+	bool FlightRecorder::install(const char* dumpPath)
+	{
+		size_t pathLength = std::min(strlen(dumpPath), sizeof(dumpPath_) - 1);
+		memcpy(dumpPath_, dumpPath, pathLength);
+		dumpPath_[pathLength] = '\0';
+
+		// only covers the installing thread, other threads dump from their own stack
+		stack_t stack = {};
+		stack.ss_sp = alternateStack;
+		stack.ss_size = sizeof(alternateStack);
+		sigaltstack(&stack, nullptr);
+
+		struct sigaction action = {};
+		action.sa_sigaction = onSignal;
+		action.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_RESETHAND;
+		sigemptyset(&action.sa_mask);
+
+		bool isInstalled = true;
+		for (int signal : crashSignals)
+			isInstalled &= sigaction(signal, &action, nullptr) == 0;
+
+		return isInstalled;
+	}
+
+	void FlightRecorder::dump(int fd)
+	{
+		LogFormat::FileHeader fileHeader = {};
+		memcpy(fileHeader.magic, LogFormat::fileMagic, sizeof(fileHeader.magic));
+		fileHeader.version = LogFormat::fileVersion;
+		writeAll(fd, &fileHeader, sizeof(fileHeader));
+
+		// all formats up front, the decoder only needs the ones that are actually referenced
+		uint32_t formatCount = std::min<uint32_t>(Logger::formatCount_.load(std::memory_order::acquire), ENGINE_LOG_MAX_FORMATS);
+		for (uint32_t id = 0; id < formatCount; id++)
+		{
+			const Logger::Format& format = Logger::formats_[id];
+			if (format.types == nullptr)
+				continue;
+
+			uint32_t argCount = static_cast<uint32_t>(format.argCount);
+			writeAll(fd, &LogFormat::formatTag, sizeof(uint32_t));
+			writeAll(fd, &id, sizeof(uint32_t));
+			writeAll(fd, &argCount, sizeof(uint32_t));
+			writeAll(fd, format.types, argCount * sizeof(LogFormat::ArgType));
+		}
+
+		uint64_t end = next_.load(std::memory_order::acquire);
+		uint64_t begin = end > ENGINE_FLIGHT_RECORDER_SLOTS ? end - ENGINE_FLIGHT_RECORDER_SLOTS : 0;
+
+		char data[sizeof(Slot::data)];
+
+		for (uint64_t index = begin; index < end; index++)
+		{
+			Slot& slot = slots_[index & (ENGINE_FLIGHT_RECORDER_SLOTS - 1)];
+
+			// skip slots that were being written or already overwritten when the crash happened
+			if (slot.sequence.load(std::memory_order::acquire) != index + 1)
+				continue;
+
+			memcpy(data, slot.data, sizeof(data));
+			std::atomic_thread_fence(std::memory_order::acquire);
+
+			if (slot.sequence.load(std::memory_order::relaxed) != index + 1)
+				continue;
+
+			LogFormat::RecordHeader header;
+			memcpy(&header, data, sizeof(header));
+			if (header.argsSize > maxArgsSize)
+				continue;
+
+			writeAll(fd, &LogFormat::recordTag, sizeof(uint32_t));
+			writeAll(fd, data, sizeof(header) + header.argsSize);
+		}
+	}
+
+	void FlightRecorder::onSignal(int signal, siginfo_t* info, void* context)
+	{
+		// a crash while dumping goes straight to the default action
+		if (!isDumping_.exchange(true))
+		{
+			int fd = open(dumpPath_, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+			if (fd >= 0)
+			{
+				dump(fd);
+				close(fd);
+
+				const char message[] = "\nFatal signal, flight recorder written to ";
+				writeAll(STDERR_FILENO, message, sizeof(message) - 1);
+				writeAll(STDERR_FILENO, dumpPath_, length(dumpPath_));
+				writeAll(STDERR_FILENO, "\n", 1);
+			}
+		}
+
+		// SA_RESETHAND restored the default action, raising again terminates with the original signal
+		raise(signal);
+	}
+};
@@ -8,7 +8,7 @@ namespace NovaEngine
 	GameWindow* GameWindow::firstWindow_ = nullptr;
 	bool GameWindow::isGlfwInitialized_ = false;
 
-	GameWindow::GameWindow(Engine* engine) : engine_(engine), window_(nullptr)
+	GameWindow::GameWindow(Engine* engine) : engine_(engine), window_(nullptr), refreshRate_(60)
 	{
 		if (!isGlfwInitialized_)
 		{
@@ -36,7 +36,7 @@ namespace NovaEngine
 
 			if (window_ == nullptr)
 			{
-				Logger::get()->error("Failed to open GLFW window.");
+				ENGINE_LOG_ERROR(GRAPHICS, "Failed to open GLFW window.");
 				return false;
 			}
 
@@ -46,11 +46,13 @@ namespace NovaEngine
 			glfwSetWindowSizeLimits(window_, config.minWidth, config.minHeight, config.maxHeight, config.maxHeight);
 			glfwSwapInterval(1);
 
+			updateRefreshRate();
+
 			return true;
 		}
 		else
 		{
-			Logger::get()->warn("Window already exists!");
+			ENGINE_LOG_WARN(GRAPHICS, "Window already exists!");
 			return false;
 		}
 	}
@@ -68,7 +70,22 @@ namespace NovaEngine
 	void GameWindow::show()
 	{
 		if (window_ != nullptr)
+		{
 			glfwShowWindow(window_);
+			updateRefreshRate();
+		}
+	}
+
+	void GameWindow::updateRefreshRate()
+	{
+		GLFWmonitor* monitor = window_ == nullptr ? nullptr : glfwGetWindowMonitor(window_);
+
+		if (monitor == nullptr)
+			monitor = glfwGetPrimaryMonitor();
+
+		const GLFWvidmode* mode = monitor == nullptr ? nullptr : glfwGetVideoMode(monitor);
+
+		refreshRate_.store(mode == nullptr || mode->refreshRate <= 0 ? 60 : mode->refreshRate, std::memory_order::relaxed);
 	}
 
 	void GameWindow::destroy()
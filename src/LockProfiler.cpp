@@ -0,0 +1,194 @@
+#include "LockProfiler.hpp"
+#include "Logger.hpp"
+
+namespace NovaEngine
+{
+	namespace
+	{
+		inline uint64_t siteKey(const std::source_location& location)
+		{
+			// 0 marks a free site slot
+			return (reinterpret_cast<uintptr_t>(location.file_name()) ^ (static_cast<uint64_t>(location.line()) << 40)) | 1;
+		}
+
+		inline size_t histogramBucket(uint64_t waitNs)
+		{
+			size_t bucket = 0;
+			while (waitNs > 1 && bucket < LockStats::histogramBuckets - 1)
+			{
+				waitNs >>= 1;
+				bucket++;
+			}
+			return bucket;
+		}
+
+		uint64_t histogramPercentile(const std::atomic<size_t>* histogram, size_t total, double percentile)
+		{
+			size_t target = static_cast<size_t>(static_cast<double>(total) * percentile);
+			size_t seen = 0;
+
+			for (size_t i = 0; i < LockStats::histogramBuckets; i++)
+			{
+				seen += histogram[i].load(std::memory_order::relaxed);
+				if (seen > target)
+					return 2ull << i;
+			}
+
+			return 2ull << (LockStats::histogramBuckets - 1);
+		}
+	}
+
+	LockStats::LockStats(const char* name) :
+		name_(name),
+		acquires_(),
+		contended_(),
+		waitNs_(),
+		maxWaitNs_(),
+		histogram_(),
+		sites_()
+	{
+		std::lock_guard<std::mutex> lock(LockProfiler::registryMutex());
+		LockProfiler::registry().push_back(this);
+	}
+
+	LockStats::~LockStats()
+	{
+		std::lock_guard<std::mutex> lock(LockProfiler::registryMutex());
+		std::vector<LockStats*>& registry = LockProfiler::registry();
+		registry.erase(std::remove(registry.begin(), registry.end(), this), registry.end());
+	}
+
+	LockStats::Site* LockStats::findSite(const std::source_location& location)
+	{
+		uint64_t key = siteKey(location);
+
+		for (Site& site : sites_)
+		{
+			uint64_t siteKey = site.key.load(std::memory_order::acquire);
+
+			if (siteKey == key)
+				return &site;
+
+			if (siteKey == 0)
+			{
+				uint64_t expected = 0;
+				if (site.key.compare_exchange_strong(expected, key, std::memory_order::acq_rel))
+				{
+					// a concurrent report skips the site until file is released after the rest
+					site.function = location.function_name();
+					site.line = location.line();
+					site.file.store(location.file_name(), std::memory_order::release);
+					return &site;
+				}
+
+				if (expected == key)
+					return &site;
+			}
+		}
+
+		// all slots are taken, the call site only shows up in the lock totals
+		return nullptr;
+	}
+
+	void LockStats::recordAcquire(const std::source_location& location, bool contended, uint64_t waitNs)
+	{
+		acquires_.fetch_add(1, std::memory_order::relaxed);
+
+		Site* site = findSite(location);
+		if (site != nullptr)
+			site->acquires.fetch_add(1, std::memory_order::relaxed);
+
+		if (!contended)
+			return;
+
+		contended_.fetch_add(1, std::memory_order::relaxed);
+		waitNs_.fetch_add(waitNs, std::memory_order::relaxed);
+		histogram_[histogramBucket(waitNs)].fetch_add(1, std::memory_order::relaxed);
+
+		uint64_t maxWait = maxWaitNs_.load(std::memory_order::relaxed);
+		while (waitNs > maxWait && !maxWaitNs_.compare_exchange_weak(maxWait, waitNs, std::memory_order::relaxed))
+			;
+
+		if (site != nullptr)
+		{
+			site->contended.fetch_add(1, std::memory_order::relaxed);
+			site->waitNs.fetch_add(waitNs, std::memory_order::relaxed);
+		}
+	}
+
+	std::mutex& LockProfiler::registryMutex()
+	{
+		// never destroyed, locks with static storage unregister during exit
+		static std::mutex* mutex = new std::mutex();
+		return *mutex;
+	}
+
+	std::vector<LockStats*>& LockProfiler::registry()
+	{
+		static std::vector<LockStats*>* registry = new std::vector<LockStats*>();
+		return *registry;
+	}
+
+	void LockProfiler::logReport()
+	{
+		Logger* l = Logger::get();
+
+#ifdef ENGINE_LOCK_PROFILING
+		// formatted while the registry is locked, a lock destroyed meanwhile unregisters only afterwards
+		std::vector<std::string> lines;
+
+		{
+			std::lock_guard<std::mutex> lock(registryMutex());
+			const std::vector<LockStats*>& locks = registry();
+
+			lines.push_back("Lock contention report (" + std::to_string(locks.size()) + " locks):");
+
+			for (LockStats* stats : locks)
+			{
+				size_t acquires = stats->acquires_.load(std::memory_order::relaxed);
+				size_t contended = stats->contended_.load(std::memory_order::relaxed);
+
+				if (acquires == 0)
+					continue;
+
+				std::string line = std::string(stats->name_) + ": " + std::to_string(acquires) + " acquires, " + std::to_string(contended) + " contended";
+
+				if (contended > 0)
+				{
+					line += ", waited " + std::to_string(stats->waitNs_.load(std::memory_order::relaxed) / 1000) + "us";
+					line += " (max " + std::to_string(stats->maxWaitNs_.load(std::memory_order::relaxed)) + "ns";
+					line += ", p50 <" + std::to_string(histogramPercentile(stats->histogram_, contended, 0.5)) + "ns";
+					line += ", p99 <" + std::to_string(histogramPercentile(stats->histogram_, contended, 0.99)) + "ns)";
+				}
+
+				lines.push_back(std::move(line));
+
+				for (LockStats::Site& site : stats->sites_)
+				{
+					if (site.key.load(std::memory_order::acquire) == 0)
+						break;
+
+					// claimed, but the metadata is still being written
+					const char* file = site.file.load(std::memory_order::acquire);
+					if (file == nullptr)
+						continue;
+
+					size_t siteContended = site.contended.load(std::memory_order::relaxed);
+					std::string siteLine = std::string("    ") + file + ":" + std::to_string(site.line) + " " + site.function + ": ";
+					siteLine += std::to_string(site.acquires.load(std::memory_order::relaxed)) + " acquires";
+
+					if (siteContended > 0)
+						siteLine += ", " + std::to_string(siteContended) + " contended, waited " + std::to_string(site.waitNs.load(std::memory_order::relaxed) / 1000) + "us";
+
+					lines.push_back(std::move(siteLine));
+				}
+			}
+		}
+
+		for (const std::string& line : lines)
+			l->info(line);
+#else
+		l->info("Lock contention report: not recorded, build with ENGINE_LOCK_PROFILING");
+#endif
+	}
+};
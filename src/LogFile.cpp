@@ -0,0 +1,151 @@
+#include "LogFile.hpp"
+
+namespace NovaEngine
+{
+	LogFile::LogFile() :
+		segmentSize_(ENGINE_LOG_SEGMENT_SIZE),
+		segmentCount_(ENGINE_LOG_SEGMENT_COUNT),
+		sequence_(0),
+		fd_(-1),
+		mapping_(nullptr),
+		offset_(0)
+	{
+	}
+
+	LogFile::~LogFile()
+	{
+		close();
+	}
+
+	std::string LogFile::segmentPath(uint64_t sequence)
+	{
+		return directory_ + "/" + name_ + "-" + std::to_string(sequence) + extension_;
+	}
+
+	std::string LogFile::indexPath()
+	{
+		return directory_ + "/" + name_ + ".index";
+	}
+
+	uint64_t LogFile::readIndex()
+	{
+		int fd = ::open(indexPath().c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+			return 0;
+
+		char buffer[32] = {};
+		ssize_t length = read(fd, buffer, sizeof(buffer) - 1);
+		::close(fd);
+
+		return length > 0 ? strtoull(buffer, nullptr, 10) : 0;
+	}
+
+	void LogFile::writeIndex()
+	{
+		// written next to the index and renamed over it, a crash never leaves a half written index behind
+		std::string path = indexPath();
+		std::string tempPath = path + ".tmp";
+
+		int fd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (fd < 0)
+			return;
+
+		std::string content = std::to_string(sequence_) + "\n";
+		bool isWritten = ::write(fd, content.data(), content.size()) == static_cast<ssize_t>(content.size());
+		::close(fd);
+
+		if (isWritten)
+			rename(tempPath.c_str(), path.c_str());
+	}
+
+	bool LogFile::openSegment()
+	{
+		std::string path = segmentPath(sequence_);
+
+		fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (fd_ < 0)
+			return false;
+
+		// reserve the blocks up front so writing into the mapping can not run out of disk space
+		void* mapping = MAP_FAILED;
+		if (posix_fallocate(fd_, 0, segmentSize_) == 0)
+			mapping = mmap(nullptr, segmentSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+
+		if (mapping == MAP_FAILED)
+		{
+			::close(fd_);
+			fd_ = -1;
+			unlink(path.c_str());
+			return false;
+		}
+
+		mapping_ = static_cast<char*>(mapping);
+		offset_ = 0;
+
+		writeIndex();
+
+		if (sequence_ >= segmentCount_)
+			unlink(segmentPath(sequence_ - segmentCount_).c_str());
+
+		return true;
+	}
+
+	void LogFile::closeSegment()
+	{
+		if (mapping_ != nullptr)
+		{
+			munmap(mapping_, segmentSize_);
+			mapping_ = nullptr;
+		}
+
+		if (fd_ >= 0)
+		{
+			// drop the preallocated but unused tail, after a crash readers stop at the first zero byte instead
+			ftruncate(fd_, offset_);
+
+			::close(fd_);
+			fd_ = -1;
+		}
+	}
+
+	bool LogFile::open(const std::string& directory, const std::string& name, const char* extension, size_t segmentSize, size_t segmentCount)
+	{
+		directory_ = directory;
+		name_ = name;
+		extension_ = extension;
+		segmentSize_ = segmentSize;
+		segmentCount_ = std::max(segmentCount, static_cast<size_t>(1));
+
+		// a fresh index starts at 1, otherwise the run continues after the latest segment
+		sequence_ = readIndex() + 1;
+
+		return openSegment();
+	}
+
+	void LogFile::close()
+	{
+		closeSegment();
+	}
+
+	bool LogFile::rotate()
+	{
+		// a segment that could not be created is retried under its sequence, failures leave no gaps behind
+		if (isOpen())
+		{
+			closeSegment();
+			sequence_++;
+		}
+
+		return openSegment();
+	}
+
+	void LogFile::write(const char* data, size_t size)
+	{
+		if (mapping_ == nullptr)
+			return;
+
+		size = std::min(size, remaining());
+		memcpy(mapping_ + offset_, data, size);
+		offset_ += size;
+	}
+};
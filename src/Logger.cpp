@@ -7,7 +7,14 @@
 namespace NovaEngine
 {
 
-	constexpr size_t formatBufferSize = 1024;
+#ifndef ENGINE_LOG_FLUSH_INTERVAL_MS
+#define ENGINE_LOG_FLUSH_INTERVAL_MS 50
+#endif
+
+// how often a log whose segment could not be created tries again
+#ifndef ENGINE_LOG_REOPEN_INTERVAL_MS
+#define ENGINE_LOG_REOPEN_INTERVAL_MS 1000
+#endif
 
 	const char* Logger::DEFAULT_COLOR = "\033[39m\033[49m";
 	const char* Logger::INFO_COLOR = "\033[34m";
@@ -16,190 +23,630 @@ namespace NovaEngine
 
 
 	std::unordered_map<std::string, Logger*> Logger::loggers_ = std::unordered_map<std::string, Logger*>();
-	std::queue<Logger::LogInfo> Logger::logQueue_;
-	std::mutex Logger::mutex_;
-	std::condition_variable Logger::cv_;
-	bool Logger::shouldTerminate_ = false;
+	std::mutex Logger::registryMutex_;
+	std::atomic<Logger*> Logger::defaultLogger_ = nullptr;
+	std::atomic<Logger::Site*> Logger::sites_ = nullptr;
+	thread_local char* Logger::pendingText_ = nullptr;
+	thread_local char Logger::siteArgs_[Logger::maxArgsSize];
+	thread_local LogRing* Logger::threadRing_ = nullptr;
+	thread_local bool Logger::isLogHandler_ = false;
+	Logger::Format Logger::formats_[ENGINE_LOG_MAX_FORMATS];
+	std::atomic<uint32_t> Logger::formatCount_ = 0;
+	InstrumentedMutex Logger::mutex_("Logger::mutex_");
+	std::condition_variable_any Logger::cv_;
+	std::atomic<bool> Logger::shouldTerminate_ = false;
+	bool Logger::binaryOutput_ = false;
+	size_t Logger::segmentSize_ = ENGINE_LOG_SEGMENT_SIZE;
+	size_t Logger::segmentCount_ = ENGINE_LOG_SEGMENT_COUNT;
+	std::atomic<Logger::Severity> Logger::severities_[static_cast<size_t>(Category::COUNT)] = {
+		Severity::INFO, Severity::INFO, Severity::INFO, Severity::INFO, Severity::INFO,
+	};
 	std::optional<std::thread> Logger::logHandlerThread_;
 
-	std::string& Logger::date()
+	Logger* Logger::get(const char* name)
 	{
-		static std::optional<std::string> dateString;
-		if (!dateString.has_value())
+		if (name == nullptr)
 		{
-			std::stringstream ss;
-			std::time_t t = std::time(0);
-			std::tm* now = std::localtime(&t);
-			ss << (now->tm_year + 1900) << '-' << (now->tm_mon + 1) << '-' << now->tm_mday;
-			dateString = ss.str();
+			Logger* logger = defaultLogger_.load(std::memory_order::acquire);
+			if (logger != nullptr)
+				return logger;
 		}
-		return dateString.value();
+
+		std::lock_guard<std::mutex> lock(registryMutex_);
+
+		std::string key = name == nullptr ? "" : name;
+		auto it = loggers_.find(key);
+		if (it != loggers_.end())
+			return it->second;
+
+		Logger* logger = create(key);
+		loggers_[key] = logger;
+
+		if (name == nullptr)
+			defaultLogger_.store(logger, std::memory_order::release);
+
+		return logger;
 	}
 
-	Logger* Logger::get(const char* name)
+	Logger* Logger::create(const std::string& name)
 	{
 		static std::string logPath = Utils::Path::combine(NovaEngine::Engine::executablePath(), "logs");
-		static size_t logPathLength = logPath.size();
-		static bool isInitialized = false;
 
-		if (!isInitialized)
+		if (!std::filesystem::exists(logPath))
+			std::filesystem::create_directory(logPath);
+
+		return new Logger(logPath, name.empty() ? "engine" : name, binaryOutput_);
+	}
+
+	void Logger::terminate()
+	{
+		for (Site* site = sites_.load(std::memory_order::acquire); site != nullptr; site = site->next)
+			flushSite(*site, std::numeric_limits<int64_t>::max());
+
+		{
+			InstrumentedLock lock(mutex_);
+			shouldTerminate_ = true;
+			cv_.notify_one();
+		}
+
+		if (logHandlerThread_.has_value() && logHandlerThread_.value().joinable())
+			logHandlerThread_.value().join();
+
+		// handles and rings stay valid for the whole process, only the files are closed,
+		// threads may still be between reserve() and commit() or hold a ring in threadRing_
+		std::lock_guard<std::mutex> registryLock(registryMutex_);
+		for (const auto& pair : loggers_)
+			pair.second->close();
+	}
+
+	std::vector<LogRing*>& Logger::rings()
+	{
+		// never destroyed, statics may still log from their destructors
+		static std::vector<LogRing*>* rings = new std::vector<LogRing*>();
+		return *rings;
+	}
+
+	LogRing* Logger::threadRing()
+	{
+		if (threadRing_ == nullptr)
+		{
+			// rings stay registered after their thread exits so nothing it logged gets lost
+			threadRing_ = new LogRing();
+			InstrumentedLock lock(mutex_);
+			rings().push_back(threadRing_);
+		}
+		return threadRing_;
+	}
+
+	void Logger::setBinaryOutput(bool binaryOutput)
+	{
+		binaryOutput_ = binaryOutput;
+	}
+
+	void Logger::setSegmentLimits(size_t segmentSize, size_t segmentCount)
+	{
+		// a whole ring drain of one logger has to fit into a single segment
+		segmentSize_ = std::max(segmentSize, LogRing::capacity() * 2);
+		segmentCount_ = segmentCount;
+	}
+
+	void Logger::setSeverity(Category category, Severity severity)
+	{
+		severities_[static_cast<size_t>(category)].store(severity, std::memory_order::relaxed);
+	}
+
+	void Logger::setSeverity(Severity severity)
+	{
+		for (std::atomic<Severity>& categorySeverity : severities_)
+			categorySeverity.store(severity, std::memory_order::relaxed);
+	}
+
+	uint32_t Logger::registerFormat(const LogFormat::ArgType* types, size_t argCount)
+	{
+		uint32_t id = formatCount_.fetch_add(1, std::memory_order::relaxed);
+		if (id >= ENGINE_LOG_MAX_FORMATS)
+			return LogFormat::invalidFormat;
+
+		formats_[id] = { types, argCount };
+		return id;
+	}
+
+	void Logger::handleLogs()
+	{
+		std::vector<LogRing*> rings;
+		std::string text;
+		std::string console;
+
+		isLogHandler_ = true;
+
+		while (true)
 		{
-			if (!std::filesystem::exists(logPath))
-				std::filesystem::create_directory(logPath);
+			bool isTerminating;
+
+			{
+				InstrumentedLock lock(mutex_);
+				if (!shouldTerminate_)
+					cv_.wait_for(lock, std::chrono::milliseconds(ENGINE_LOG_FLUSH_INTERVAL_MS));
+				isTerminating = shouldTerminate_;
+			}
+
+			// repeats are written once their window is over, not only when the site logs something else
+			int64_t now = LogFormat::now();
+			for (Site* site = sites_.load(std::memory_order::acquire); site != nullptr; site = site->next)
+				flushSite(*site, now);
+
+			{
+				InstrumentedLock lock(mutex_);
+				rings = Logger::rings();
+			}
+
+			for (LogRing* ring : rings)
+				drainRing(ring, text, console);
+
+			if (!console.empty())
+			{
+				fwrite(console.data(), 1, console.size(), stdout);
+				fflush(stdout);
+				console.clear();
+			}
 
-			isInitialized = true;
+			if (isTerminating)
+				break;
 		}
+	}
+
+	void Logger::drainRing(LogRing* ring, std::string& text, std::string& console)
+	{
+		Logger* target = nullptr;
+		text.clear();
 
-		std::string fileName = std::string(name == nullptr ? "" : name) + Logger::date();
+		const char* payload;
+		uint32_t size;
+		uint32_t flags;
 
-		if (loggers_.find(fileName) == loggers_.end())
+		while (ring->front(&payload, &size, &flags))
 		{
-			std::filesystem::path p = logPath;
+			Logger* logger;
+			memcpy(&logger, payload, sizeof(Logger*));
 
-			size_t version = 0;
-			for (const auto& entry : std::filesystem::directory_iterator(p))
+			// consecutive records of the same logger end up in a single write
+			if (logger != target && target != nullptr)
 			{
-				std::string foundName = entry.path().filename();
-				foundName.resize(foundName.size() - 4);
-				foundName[foundName.size()] = '\0';
-
-				if (version == 0 && foundName == fileName)
-				{
-					version = 1;
-				}
-				else if (strncmp(foundName.c_str(), fileName.c_str(), fileName.size()) == 0)
-				{
-					size_t v = static_cast<size_t>(atoi(&foundName[fileName.size() + 1])) + 1;
-					if (v > version)
-						version = v;
-				}
+				target->file_.write(text.data(), text.size());
+				text.clear();
 			}
-			std::string generatedFileName = fileName;
-			if (version != 0)
-				generatedFileName += "-" + std::to_string(version);
+			target = logger;
+
+			const char* record = payload + sizeof(Logger*);
+			size_t recordSize = size - sizeof(Logger*);
+
+			LogFormat::RecordHeader header;
+			memcpy(&header, record, sizeof(header));
+			const char* args = record + sizeof(header);
+
+			const Format* format = header.formatId < ENGINE_LOG_MAX_FORMATS ? &formats_[header.formatId] : nullptr;
+			const LogFormat::ArgType* types = format != nullptr ? format->types : nullptr;
+			size_t argCount = format != nullptr ? format->argCount : 0;
 
-			std::string path = Utils::Path::combine(logPath, generatedFileName + ".log");
-			loggers_[fileName] = new Logger(path.c_str());
+			size_t lineStart = console.size();
+			LogFormat::appendLine(console, header, types, argCount, args);
+
+			logger->appendRecord(record, recordSize, console.data() + lineStart, console.size() - lineStart, text);
+
+			// the console gets colors around the severity, the file text stays plain
+			const char* color = header.severity == Severity::ERROR ? ERROR_COLOR : header.severity == Severity::WARNING ? WARN_COLOR : header.severity == Severity::VERBOSE ? DEFAULT_COLOR : INFO_COLOR;
+			size_t severityStart = console.find('[', lineStart + 1);
+			size_t severityEnd = console.find(']', severityStart);
+			console.insert(severityEnd + 1, DEFAULT_COLOR);
+			console.insert(severityStart, color);
+
+			ring->next();
 		}
 
-		return loggers_[fileName];
+		if (target != nullptr)
+			target->file_.write(text.data(), text.size());
+		text.clear();
+
+		ring->release();
 	}
 
-	void Logger::terminate()
+	void Logger::appendRecord(const char* record, size_t size, const char* line, size_t lineSize, std::string& out)
 	{
-		shouldTerminate_ = true;
+		if (!file_.isOpen() && !reopen())
+		{
+			droppedRecords_++;
+			return;
+		}
+
+		size_t start = out.size();
+		appendRecordAfterDrops(record, size, line, lineSize, out);
+
+		if (out.size() <= file_.remaining())
+			return;
 
-		if (logHandlerThread_.has_value())
+		// records never straddle segments, everything before this one still goes into the current segment
+		out.resize(start);
+		file_.write(out.data(), out.size());
+		out.clear();
+		rotate();
+
+		if (!file_.isOpen())
 		{
-			cv_.notify_one();
-			if (logHandlerThread_.value().joinable())
-				logHandlerThread_.value().join();
+			droppedRecords_++;
+			return;
 		}
 
-		for (const auto& pair : loggers_)
-			delete pair.second;
+		appendRecordAfterDrops(record, size, line, lineSize, out);
 	}
 
-	Logger::Logger(const char* path) : logFile_(path)
+	void Logger::appendRecordAfterDrops(const char* record, size_t size, const char* line, size_t lineSize, std::string& out)
 	{
-		if (!logHandlerThread_.has_value())
-			logHandlerThread_.emplace(std::thread([&]() {
-			time_t rawtime;
-			struct tm* timeinfo;
-			char timeBuf[10] = {};
+		if (isBinary_)
+		{
+			appendBinary(record, size, out);
 
-			while (!shouldTerminate_)
+			// the first record after a gap carries its size, the decoder prints it like a rate limit drop
+			if (droppedRecords_ > 0)
 			{
-				std::unique_lock<std::mutex> lock(mutex_);
-				cv_.wait(lock);
-				lock.unlock();
-
-				while (logQueue_.size() > 0)
-				{
-					Logger::LogInfo& info = logQueue_.front();
-
-					if (info.isNewLine)
-					{
-						time(&rawtime);
-						timeinfo = localtime(&rawtime);
-						strftime(timeBuf, 10, "%T", timeinfo);
-
-						info.logger->logFile_ << "[" << timeBuf << "] ";
-					}
-
-					info.logger->logFile_ << info.data;
-					info.logger->logFile_.flush();
-					lock.lock();
-					logQueue_.pop();
-					lock.unlock();
-				}
+				char* written = out.data() + out.size() - size;
+				LogFormat::RecordHeader header;
+				memcpy(&header, written, sizeof(header));
+				header.dropped += droppedRecords_;
+				memcpy(written, &header, sizeof(header));
 			}
-		}));
+		}
+		else
+		{
+			if (droppedRecords_ > 0)
+				out += "--- " + std::to_string(droppedRecords_) + " records dropped, the log file could not be written ---\n";
+
+			out.append(line, lineSize);
+		}
+
+		droppedRecords_ = 0;
 	}
 
-	Logger::~Logger()
+	void Logger::rotate()
+	{
+		if (file_.rotate())
+			writeSegmentHeader();
+		else
+			reopenTime_ = LogFormat::now() + ENGINE_LOG_REOPEN_INTERVAL_MS * 1000000ll;
+	}
+
+	bool Logger::reopen()
+	{
+		// retried at most once per interval instead of for every record while the disk is full
+		if (LogFormat::now() < reopenTime_)
+			return false;
+
+		rotate();
+		return file_.isOpen();
+	}
+
+	void Logger::writeSegmentHeader()
+	{
+		if (isBinary_)
+		{
+			LogFormat::FileHeader fileHeader = {};
+			memcpy(fileHeader.magic, LogFormat::fileMagic, sizeof(fileHeader.magic));
+			fileHeader.version = LogFormat::fileVersion;
+			file_.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+
+			writtenFormats_.clear();
+		}
+		else
+		{
+			time_t rawTime = time(nullptr);
+			struct tm timeInfo;
+			localtime_r(&rawTime, &timeInfo);
+
+			char buffer[64];
+			size_t length = strftime(buffer, sizeof(buffer), "--- segment started %F %T ---\n", &timeInfo);
+			file_.write(buffer, length);
+		}
+	}
+
+	void Logger::appendBinary(const char* record, size_t size, std::string& out)
 	{
-		if (logFile_.is_open())
-			logFile_.close();
+		LogFormat::RecordHeader header;
+		memcpy(&header, record, sizeof(header));
+
+		// the decoder needs the argument types of a format before its first record
+		if (header.formatId < ENGINE_LOG_MAX_FORMATS)
+		{
+			if (writtenFormats_.size() <= header.formatId)
+				writtenFormats_.resize(header.formatId + 1, false);
+
+			if (!writtenFormats_[header.formatId])
+			{
+				const Format& format = formats_[header.formatId];
+				uint32_t argCount = static_cast<uint32_t>(format.argCount);
+
+				out.append(reinterpret_cast<const char*>(&LogFormat::formatTag), sizeof(uint32_t));
+				out.append(reinterpret_cast<const char*>(&header.formatId), sizeof(uint32_t));
+				out.append(reinterpret_cast<const char*>(&argCount), sizeof(uint32_t));
+				out.append(reinterpret_cast<const char*>(format.types), argCount * sizeof(LogFormat::ArgType));
+				writtenFormats_[header.formatId] = true;
+			}
+		}
+
+		out.append(reinterpret_cast<const char*>(&LogFormat::recordTag), sizeof(uint32_t));
+		out.append(record, size);
 	}
 
-	void Logger::logRest(const char* str) 
+	Logger::Logger(const std::string& directory, const std::string& name, bool isBinary) : isBinary_(isBinary), reopenTime_(0), droppedRecords_(0)
 	{
-		printf("%s", str);
-		forward(str);
+		if (file_.open(directory, name, isBinary_ ? ".nlg" : ".log", segmentSize_, segmentCount_))
+			writeSegmentHeader();
+		else
+			reopenTime_ = LogFormat::now() + ENGINE_LOG_REOPEN_INTERVAL_MS * 1000000ll;
+
+		if (!logHandlerThread_.has_value())
+			logHandlerThread_.emplace(std::thread(handleLogs));
 	}
 
-	void Logger::logRest(std::string& str)
+	Logger::~Logger()
 	{
-		printf("%s", str.c_str());
-		forward(str.c_str());
+		close();
 	}
 
-	void Logger::log(const char* str)
+	void Logger::close()
 	{
-		log(std::string(str));
+		file_.close();
 	}
 
-	void Logger::log(std::string& str)
+	char* Logger::reserve(size_t size)
 	{
-		char formatBuffer[formatBufferSize];
+		// nobody drains the rings after terminate()
+		if (shouldTerminate_.load(std::memory_order::relaxed))
+			return nullptr;
+
+		LogRing* ring = threadRing();
 
-		// prevents buffer overflow
-		if(str.size() > formatBufferSize)
+		char* payload;
+		while ((payload = ring->reserve(sizeof(Logger*) + size, 0)) == nullptr)
 		{
-			str.resize(formatBufferSize - 2);
-			str[formatBufferSize - 5] = '.';
-			str[formatBufferSize - 4] = '.';
-			str[formatBufferSize - 3] = '.';
-			str[formatBufferSize - 2] = '\0';
+			// only the log handler thread itself could make room
+			if (shouldTerminate_ || isLogHandler_)
+				return nullptr;
+
+			cv_.notify_one();
+			std::this_thread::yield();
 		}
-		
-		sprintf(formatBuffer, "%s\n", str.c_str());
-		printf("%s", formatBuffer);
-		forward(formatBuffer);
+
+		Logger* logger = this;
+		memcpy(payload, &logger, sizeof(Logger*));
+		return payload + sizeof(Logger*);
 	}
 
-	void Logger::forward(const char* str, bool newLine)
+	void Logger::commit()
 	{
-		std::unique_lock<std::mutex> lock(mutex_);
-		Logger::LogInfo info = {
-			.isNewLine = newLine,
-			.logger = this,
-			.data = str
-		};
-		logQueue_.push(info);
-		cv_.notify_one();
+		LogRing* ring = threadRing_;
+		ring->commit();
+
+		if (ring->usedBytes() > LogRing::capacity() / 2)
+			cv_.notify_one();
 	}
 
-	void Logger::forward(std::string& str, bool newLine)
+	namespace
 	{
-		std::unique_lock<std::mutex> lock(mutex_);
-		Logger::LogInfo info = {
-			.isNewLine = newLine,
-			.logger = this,
-			.data = str
+		uint64_t hashRecord(uint32_t formatId, const char* args, size_t argsSize)
+		{
+			uint64_t hash = 14695981039346656037ull ^ formatId;
+			for (size_t i = 0; i < argsSize; i++)
+				hash = (hash ^ static_cast<uint8_t>(args[i])) * 1099511628211ull;
+			return hash;
+		}
+
+		class SiteLock
+		{
+		private:
+			std::atomic<bool>& isLocked_;
+
+		public:
+			SiteLock(std::atomic<bool>& isLocked) : isLocked_(isLocked)
+			{
+				while (isLocked_.exchange(true, std::memory_order::acquire))
+					std::this_thread::yield();
+			}
+
+			~SiteLock() { isLocked_.store(false, std::memory_order::release); }
 		};
-		logQueue_.push(info);
-		cv_.notify_one();
+	}
+
+	void Logger::emit(uint32_t formatId, Category category, Severity severity, const char* args, size_t argsSize, uint32_t repeated, uint32_t dropped)
+	{
+		char* record = reserve(sizeof(LogFormat::RecordHeader) + argsSize);
+		if (record == nullptr)
+			return;
+
+		LogFormat::RecordHeader header = {};
+		header.formatId = formatId;
+		header.argsSize = static_cast<uint32_t>(argsSize);
+		header.timestamp = LogFormat::now();
+		header.severity = severity;
+		header.category = category;
+		header.repeated = repeated;
+		header.dropped = dropped;
+
+		memcpy(record, &header, sizeof(header));
+		memcpy(record + sizeof(header), args, argsSize);
+		commit();
+	}
+
+	void Logger::emitAtSite(Site& site, uint32_t formatId, Category category, Severity severity, const char* args, size_t argsSize, char* reserved)
+	{
+		if (!site.isRegistered.exchange(true, std::memory_order::acq_rel))
+		{
+			site.next = sites_.load(std::memory_order::relaxed);
+			while (!sites_.compare_exchange_weak(site.next, &site, std::memory_order::release, std::memory_order::relaxed))
+				;
+		}
+
+		uint64_t hash = hashRecord(formatId, args, argsSize);
+		int64_t now = LogFormat::now();
+		constexpr int64_t window = ENGINE_LOG_DEDUP_WINDOW_MS * 1000000ll;
+
+		// the previous message, if its repeats still have to be written before this one
+		char pending[ENGINE_LOG_SITE_BUFFER];
+		size_t pendingSize = 0;
+		uint32_t pendingRepeated = 0;
+		uint32_t pendingFormatId = 0;
+		Category pendingCategory = Category::GENERAL;
+		Severity pendingSeverity = Severity::INFO;
+		Logger* pendingLogger = nullptr;
+
+		bool isAllowed = false;
+		uint32_t repeated = 0;
+		uint32_t dropped = 0;
+
+		{
+			SiteLock lock(site.isLocked);
+
+			bool isLast = site.lastSize > 0 && site.hash == hash;
+
+			if (isLast && now - site.windowStart < window)
+			{
+				site.repeated++;
+				return;
+			}
+
+			if (isLast)
+			{
+				repeated = site.repeated;
+			}
+			else if (site.repeated > 0)
+			{
+				memcpy(pending, site.last, site.lastSize);
+				pendingSize = site.lastSize;
+				pendingRepeated = site.repeated;
+				pendingFormatId = site.formatId;
+				pendingCategory = site.category;
+				pendingSeverity = site.severity;
+				pendingLogger = site.logger;
+			}
+			site.repeated = 0;
+
+			double elapsed = static_cast<double>(now - site.lastRefill) / 1e9;
+			site.tokens = std::min<double>(ENGINE_LOG_SITE_BURST, site.tokens + elapsed * ENGINE_LOG_SITE_RATE);
+			site.lastRefill = now;
+
+			isAllowed = site.tokens >= 1.0;
+
+			if (!isAllowed)
+			{
+				site.dropped++;
+				site.lastSize = 0;
+			}
+			else
+			{
+				site.tokens -= 1.0;
+				dropped = site.dropped;
+				site.dropped = 0;
+
+				// remembered to fold the next repeats, messages that are too long never get folded
+				site.hash = hash;
+				site.windowStart = now;
+				site.logger = this;
+				site.formatId = formatId;
+				site.category = category;
+				site.severity = severity;
+				site.lastSize = argsSize <= sizeof(site.last) ? argsSize : 0;
+				if (site.lastSize > 0)
+					memcpy(site.last, args, argsSize);
+			}
+		}
+
+		if (pendingLogger != nullptr)
+		{
+			// the repeats need the ring first, only then the reserved record is copied out of it
+			if (reserved != nullptr && isAllowed)
+			{
+				memcpy(siteArgs_, args, argsSize);
+				args = siteArgs_;
+			}
+			reserved = nullptr;
+
+			pendingLogger->emit(pendingFormatId, pendingCategory, pendingSeverity, pending, pendingSize, pendingRepeated, 0);
+		}
+
+		if (!isAllowed)
+			return;
+
+		if (reserved == nullptr)
+		{
+			emit(formatId, category, severity, args, argsSize, repeated, dropped);
+			return;
+		}
+
+		LogFormat::RecordHeader header;
+		memcpy(&header, reserved, sizeof(header));
+		header.argsSize = static_cast<uint32_t>(argsSize);
+		header.repeated = repeated;
+		header.dropped = dropped;
+		memcpy(reserved, &header, sizeof(header));
+
+		LogRing* ring = threadRing_;
+		ring->commit(sizeof(Logger*) + sizeof(header) + argsSize);
+
+		if (ring->usedBytes() > LogRing::capacity() / 2)
+			cv_.notify_one();
+	}
+
+	void Logger::flushSite(Site& site, int64_t now)
+	{
+		SiteLock lock(site.isLocked);
+
+		if (site.repeated == 0 || now - site.windowStart < ENGINE_LOG_DEDUP_WINDOW_MS * 1000000ll)
+			return;
+
+		if (site.logger != nullptr)
+			site.logger->emit(site.formatId, site.category, site.severity, site.last, site.lastSize, site.repeated, 0);
+
+		site.repeated = 0;
+	}
+
+	char* Logger::beginText(Category category, Severity severity, size_t* maxLength)
+	{
+		if (!isEnabled(category, severity))
+			return nullptr;
+
+		uint32_t id = formatId<LogFormat::ArgType::STRING>();
+		if (id == LogFormat::invalidFormat)
+			return nullptr;
+
+		*maxLength = std::min(*maxLength, maxArgsSize - sizeof(uint32_t));
+
+		char* record = reserve(sizeof(LogFormat::RecordHeader) + sizeof(uint32_t) + *maxLength);
+		if (record == nullptr)
+			return nullptr;
+
+		LogFormat::RecordHeader header = {};
+		header.formatId = id;
+		header.timestamp = LogFormat::now();
+		header.severity = severity;
+		header.category = category;
+		memcpy(record, &header, sizeof(header));
+
+		pendingText_ = record;
+		return record + sizeof(header) + sizeof(uint32_t);
+	}
+
+	void Logger::commitText(Site& site, size_t length)
+	{
+		char* record = pendingText_;
+		pendingText_ = nullptr;
+
+		LogFormat::RecordHeader header;
+		memcpy(&header, record, sizeof(header));
+
+		uint32_t stringLength = static_cast<uint32_t>(length);
+		memcpy(record + sizeof(header), &stringLength, sizeof(stringLength));
+
+		const char* args = record + sizeof(header);
+		FlightRecorder::record(header.formatId, header.category, header.severity, std::string_view(args + sizeof(uint32_t), length));
+
+		emitAtSite(site, header.formatId, header.category, header.severity, args, sizeof(uint32_t) + length, record);
 	}
 };
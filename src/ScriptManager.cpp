@@ -28,7 +28,7 @@ namespace NovaEngine
 			context_.Reset(isolate_, context);
 		}
 
-		run([&](const RunInfo& info) {
+		runLocked([&](const RunInfo& info) {
 			uint32_t index = static_cast<uint32_t>(std::distance(instances_.begin(), std::find(instances_.begin(), instances_.end(), this)));
 			scriptManagerReference_.Reset(isolate_, v8::Number::New(isolate_, index));
 			v8::Local<v8::Object> global = info.context->Global();
@@ -59,7 +59,7 @@ namespace NovaEngine
 		{
 			v8::V8::Dispose();
 			v8::V8::ShutdownPlatform();
-			Logger::get()->info("V8 Disposed!");
+			ENGINE_LOG_INFO(SCRIPT, "V8 Disposed!");
 		}
 
 		return true;
@@ -109,20 +109,8 @@ namespace NovaEngine
 
 	std::string ScriptManager::getRelativePath(const std::string& str)
 	{
-		static std::string scriptPath = Utils::Path::combine(engine()->executablePath(), "assets", "scripts");
-		static size_t l = scriptPath.length();
-
-		std::string testPath = Utils::Path::combine(engine()->executablePath(), "assets", "scripts", str);
-
-		char* formattedPath = realpath(testPath.c_str(), NULL);
-
-		size_t copySize = strlen(formattedPath) - l - 1;
-
-		std::string relativePath = std::string(&formattedPath[l + 1]);
-
-		free(formattedPath);
-
-		return relativePath;
+		// resolved without the file system, the module may only exist inside assets.pak and every require would cost a syscall
+		return std::filesystem::path(str).lexically_normal().generic_string();
 	}
 
 	ScriptManager* ScriptManager::callbackDataToScriptManager(const v8::Local<v8::Context>& ctx, const v8::Local<v8::Value>& data)
@@ -157,7 +145,7 @@ namespace NovaEngine
 
 			size_t l = absPathVal.length();
 
-			char absPathCpy[l] = {};
+			char absPathCpy[l + 1] = {};
 			strcpy(absPathCpy, *absPathVal);
 
 			while (l > 0)
@@ -171,7 +159,7 @@ namespace NovaEngine
 			}
 
 
-			std::string modulePath(l == 0 ? "" : absPathCpy);
+			std::string modulePath(l == 0 ? "" : std::string(absPathCpy) + "/");
 
 			v8::Handle<v8::String> requirePath = v8::Handle<v8::String>::Cast(args[0]);
 			v8::String::Utf8Value output(isolate, requirePath);
@@ -200,7 +188,7 @@ namespace NovaEngine
 
 				if (modules_.find(cleanModulePath) == modules_.end())
 				{
-					Logger::get()->warn("could not get exports!");
+					ENGINE_LOG_WARN(SCRIPT, "could not get exports!");
 					return;
 				}
 				else
@@ -224,6 +212,8 @@ namespace NovaEngine
 	{
 		if (modules_.find(path) == modules_.end())
 		{
+			assert(isolateMutex_.isLocked());
+
 			v8::Locker isolateLocker(isolate_);
 			v8::Isolate::Scope isolate_scope(isolate_);
 
@@ -231,10 +221,20 @@ namespace NovaEngine
 			v8::Local<v8::Context> context = v8::Local<v8::Context>::New(isolate_, context_);
 			v8::Context::Scope context_scope(context);
 
-			std::vector<char> content = { '\0' };
+			AssetView content;
 			std::string scriptPath = Utils::Path::combine("scripts", path).string();
 
-			this->engine()->assetManager.loadTextFile(scriptPath.c_str(), content);
+			// make cook leaves the json modules already wrapped next to the raw ones, unless the raw one was edited since
+			bool isCookedModule = false;
+			if (isJsonModule)
+			{
+				std::string cookedPath = scriptPath + ".js";
+				AssetManager& assetManager = this->engine()->assetManager;
+				isCookedModule = assetManager.fileExists(cookedPath.c_str()) && !assetManager.isModifiedAfter(scriptPath.c_str(), cookedPath.c_str()) && assetManager.mapFile(cookedPath.c_str(), content);
+			}
+
+			if (!isCookedModule)
+				this->engine()->assetManager.mapFile(scriptPath.c_str(), content);
 
 			v8::Local<v8::Object> global = context->Global();
 			v8::Local<v8::Object> exports = v8::Object::New(isolate_);
@@ -242,23 +242,30 @@ namespace NovaEngine
 
 			if (!exports->Set(context, createString("__ABSOLUTE_PATH__"), createString(path)).ToChecked())
 			{
-				Logger::get()->warn("Failed to set __ABSOLUTE_PATH__!");
+				ENGINE_LOG_WARN(SCRIPT, "Failed to set __ABSOLUTE_PATH__!");
 				if (!prevExports.IsEmpty() && (moduleRequireCounter_ != 0))
 					global->Set(context, createString("exports"), prevExports.ToLocalChecked()->ToObject());
 			}
 
 			if (!global->Set(context, createString("exports"), exports).ToChecked())
 			{
-				Logger::get()->warn("Failed to set exports!");
+				ENGINE_LOG_WARN(SCRIPT, "Failed to set exports!");
 				if (!prevExports.IsEmpty() && (moduleRequireCounter_ != 0))
 					global->Set(context, createString("exports"), prevExports.ToLocalChecked()->ToObject());
 			}
 
 			modules_[std::string(path)].Reset(isolate_, exports);
 
-			std::string scriptContents = isJsonModule ? std::string("exports.data = ") + content.data() : content.data();
-
-			v8::Local<v8::String> source = v8::String::NewFromUtf8(isolate_, scriptContents.c_str(), v8::NewStringType::kNormal).ToLocalChecked();
+			// plain scripts and cooked modules compile straight from the mapping, only raw json modules need a wrapped copy
+			v8::Local<v8::String> source;
+			if (isJsonModule && !isCookedModule)
+			{
+				std::string scriptContents = "exports.data = ";
+				scriptContents.append(content.text());
+				source = v8::String::NewFromUtf8(isolate_, scriptContents.data(), v8::NewStringType::kNormal, static_cast<int>(scriptContents.size())).ToLocalChecked();
+			}
+			else
+				source = v8::String::NewFromUtf8(isolate_, content.empty() ? "" : content.data(), v8::NewStringType::kNormal, static_cast<int>(content.size())).ToLocalChecked();
 
 			v8::Local<v8::Script> script = v8::Script::Compile(context, source).ToLocalChecked();
 
@@ -272,6 +279,25 @@ namespace NovaEngine
 		}
 	}
 
+	bool ScriptManager::reload(const char* path, bool isJsonModule)
+	{
+		bool isLoaded = false;
+
+		run([&](const RunInfo& runInfo) {
+			auto module = modules_.find(path);
+			if (module == modules_.end())
+				return;
+
+			module->second.Reset();
+			modules_.erase(module);
+
+			load(path, isJsonModule);
+			isLoaded = modules_.find(path) != modules_.end();
+		});
+
+		return isLoaded;
+	}
+
 	Engine* ScriptManager::fetchEngineFromArgs(const v8::FunctionCallbackInfo<v8::Value>& args)
 	{
 		return static_cast<Engine*>(args.GetIsolate()->GetData(0));
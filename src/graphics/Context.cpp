@@ -46,7 +46,7 @@ namespace NovaEngine::Graphics
 		glfwSetWindowUserPointer(window, reinterpret_cast<void*>(this));
 		glfwSetFramebufferSizeCallback(window, onFrameBufferResizedCallback);
 
-		Logger::get()->info("Context initialized!\n");
+		ENGINE_LOG_INFO(GRAPHICS, "Context initialized!");
 
 		return true;
 	}
@@ -129,7 +129,7 @@ namespace NovaEngine::Graphics
 
 		if (recreate)
 		{
-			Logger::get()->info("Recreating swapchain...");
+			ENGINE_LOG_INFO(GRAPHICS, "Recreating swapchain...");
 
 			VkSwapchainKHR oldSwapChain = swapChain_;
 
@@ -19,12 +19,14 @@ namespace NovaEngine::Graphics
 				if (strncmp(pCallbackData->pMessage, "Device Extension: ", 18) == 0)
 					return VK_FALSE;
 
-				if ((messageSeverity == VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT) || (messageSeverity == VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT))
-					Logger::get()->info(pCallbackData->pMessage);
+				if (messageSeverity == VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT)
+					ENGINE_LOG_VERBOSE(GRAPHICS, pCallbackData->pMessage);
+				if (messageSeverity == VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT)
+					ENGINE_LOG_INFO(GRAPHICS, pCallbackData->pMessage);
 				if (messageSeverity == VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
-					Logger::get()->warn(pCallbackData->pMessage);
+					ENGINE_LOG_WARN(GRAPHICS, pCallbackData->pMessage);
 				if (messageSeverity == VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
-					Logger::get()->error(pCallbackData->pMessage);
+					ENGINE_LOG_ERROR(GRAPHICS, pCallbackData->pMessage);
 
 				return VK_FALSE;
 			}
@@ -0,0 +1,60 @@
+#include "job_system/AsyncSemaphore.hpp"
+#include "job_system/JobScheduler.hpp"
+
+namespace NovaEngine::JobSystem
+{
+	bool AsyncSemaphore::tryAcquire()
+	{
+		InstrumentedLock lock(mutex_);
+
+		if (count_ == 0)
+			return false;
+
+		count_--;
+		return true;
+	}
+
+	size_t AsyncSemaphore::available()
+	{
+		InstrumentedLock lock(mutex_);
+		return count_;
+	}
+
+	bool AsyncSemaphore::suspend(JobHandle handle)
+	{
+		InstrumentedLock lock(mutex_);
+
+		// released between await_ready and now, continue without suspending
+		if (count_ > 0)
+		{
+			count_--;
+			return false;
+		}
+
+		waiters_.push({ handle, JobScheduler::current() });
+		JobScheduler::parkCurrentJob();
+
+		return true;
+	}
+
+	void AsyncSemaphore::release(size_t count)
+	{
+		std::vector<Waiter> woken;
+
+		{
+			InstrumentedLock lock(mutex_);
+
+			while (count > 0 && !waiters_.empty())
+			{
+				woken.push_back(waiters_.front());
+				waiters_.pop();
+				count--;
+			}
+
+			count_ += count;
+		}
+
+		for (Waiter& waiter : woken)
+			waiter.scheduler->resumeJob(waiter.handle);
+	}
+}
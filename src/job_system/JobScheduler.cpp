@@ -5,6 +5,15 @@ namespace NovaEngine::JobSystem
 {
 	static std::atomic<size_t> threadIdCounter = 0;
 
+	thread_local size_t JobScheduler::workerIndex_ = JobScheduler::noWorker_;
+	thread_local JobScheduler* JobScheduler::currentScheduler_ = nullptr;
+	thread_local bool JobScheduler::isJobParked_ = false;
+
+	static inline size_t affinitySlot(uintptr_t affinity)
+	{
+		return static_cast<size_t>((static_cast<uint64_t>(affinity) * 0x9E3779B97F4A7C15ull) >> 32) % ENGINE_JOB_SYSTEM_AFFINITY_SLOTS;
+	}
+
 	bool JobScheduler::onInitialize(size_t maxJobs, size_t executionThreads)
 	{
 		maxJobs_ = maxJobs == 0 ? ENGINE_JOB_SYSTEM_MAX_JOBS : maxJobs;
@@ -18,48 +27,327 @@ namespace NovaEngine::JobSystem
 			stopThreads();
 
 		joinThreads();
+		logStats();
 
 		return true;
 	}
 
-	void JobScheduler::threadEntry(size_t threadID)
+	void JobScheduler::logStats()
+	{
+		ENGINE_LOG_INFO(JOBS, "Job affinity: ", stats_.affinityHits.load(), " hits, ",
+			stats_.affinityMisses.load(), " misses, ",
+			stats_.affinitySteals.load(), " steals");
+		ENGINE_LOG_INFO(JOBS, "Job deadlines: ", stats_.missedDeadlines.load(), " of ",
+			stats_.deadlineJobs.load(), " missed");
+		ENGINE_LOG_INFO(JOBS, "Job workers: ", activeWorkers_.load(), " of ", executionThreads_, " active, ",
+			stats_.parks.load(), " parks, ", stats_.unparks.load(), " unparks");
+	}
+
+	void JobScheduler::setWorkerLimits(size_t minWorkers, size_t maxWorkers)
+	{
+		if (maxWorkers != 0 && threads_.size() == 0)
+			executionThreads_ = maxWorkers;
+
+		minWorkers_ = std::min(minWorkers, executionThreads_);
+	}
+
+	bool JobScheduler::tryPark(size_t workerIndex)
 	{
+		size_t active = activeWorkers_.load(std::memory_order::acquire);
+		do
+		{
+			if (active <= minWorkers_)
+				return false;
+		} while (!activeWorkers_.compare_exchange_weak(active, active - 1, std::memory_order::acq_rel));
+
+		Worker& worker = *workers_[workerIndex];
+		worker.isParked.store(true, std::memory_order::release);
+		stats_.parks.fetch_add(1, std::memory_order::relaxed);
+		ENGINE_FLIGHT_EVENT(JOBS, "worker ", workerIndex, " parked");
+
+		{
+			InstrumentedLock lock(parkMutex_);
+			parkedWorkers_.fetch_add(1, std::memory_order::acq_rel);
+
+			while (threadsRunning_.load(std::memory_order::acquire) == 1)
+			{
+				if (unparkRequests_ > 0)
+				{
+					unparkRequests_--;
+					break;
+				}
+
+				if (readyJobs_.load(std::memory_order::relaxed) > activeWorkers_.load(std::memory_order::relaxed) * ENGINE_JOB_SYSTEM_UNPARK_DEPTH)
+					break;
+
+				// also wake up now and then in case the wake up was missed while the queues grew
+				parkCv_.wait_for(lock, std::chrono::milliseconds(50));
+			}
+
+			parkedWorkers_.fetch_sub(1, std::memory_order::acq_rel);
+		}
+
+		worker.isParked.store(false, std::memory_order::release);
+		activeWorkers_.fetch_add(1, std::memory_order::acq_rel);
+		stats_.unparks.fetch_add(1, std::memory_order::relaxed);
+		ENGINE_FLIGHT_EVENT(JOBS, "worker ", workerIndex, " unparked");
+
+		return true;
+	}
+
+	void JobScheduler::unparkWorker()
+	{
+		InstrumentedLock lock(parkMutex_);
+
+		if (unparkRequests_ < parkedWorkers_.load(std::memory_order::acquire))
+		{
+			unparkRequests_++;
+			parkCv_.notify_one();
+		}
+	}
+
+	void JobScheduler::threadEntry(size_t workerIndex)
+	{
+		size_t threadID = threadIdCounter.fetch_add(1, std::memory_order::acq_rel);
+		workerIndex_ = workerIndex;
+
 		while (threadsRunning_.load(std::memory_order::acquire) != 1)
 			; // wait (spin lock)
 
-		Logger::get()->info("Thread with threadID ", std::to_string(threadID), " started...");
+		ENGINE_LOG_VERBOSE(JOBS, "Thread with threadID ", threadID, " started...");
 
 		JobHandle jobHandle;
+		bool isIdle = false;
+		std::chrono::steady_clock::time_point idleSince;
+
 		while (threadsRunning_)
 		{
 			if (runNextJob(&jobHandle))
+			{
 				handleJobYield(&jobHandle);
+				isIdle = false;
+				continue;
+			}
+
+			if (readyJobs_.load(std::memory_order::relaxed) != 0)
+			{
+				isIdle = false;
+				continue;
+			}
+
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+			if (!isIdle)
+			{
+				isIdle = true;
+				idleSince = now;
+			}
+			else if (now - idleSince >= std::chrono::microseconds(ENGINE_JOB_SYSTEM_PARK_DELAY_US) && tryPark(workerIndex))
+			{
+				isIdle = false;
+				continue;
+			}
+
+			std::this_thread::yield();
 		}
 	}
 
 	bool JobScheduler::runNextJob(JobHandlePtr handleOut)
 	{
-		if (readyQueue_.pop(handleOut))
+		for (size_t i = 0; i < priorityCount_; i++)
 		{
-			if (handleOut != nullptr && !handleOut->done())
+			if (popReady(i, handleOut))
 			{
-				handleOut->resume();
+				if (handleOut != nullptr && !handleOut->done())
+				{
+					uintptr_t affinity = handleOut->promise().affinity;
+					if (affinity != 0 && workerIndex_ < workers_.size())
+						affinityOwners_[affinitySlot(affinity)].store(workerIndex_, std::memory_order::relaxed);
+
+					currentScheduler_ = this;
+					handleOut->resume();
+
+					// the job now belongs to whatever it awaited, another thread may already be running it
+					if (isJobParked_)
+					{
+						isJobParked_ = false;
+						return false;
+					}
+
+					return true;
+				}
+				return false;
+			}
+		}
+
+		return false;
+	}
+
+	bool JobScheduler::popReady(size_t priority, JobHandlePtr handleOut)
+	{
+		size_t worker = workerIndex_;
+		bool isWorker = worker < workers_.size();
+
+		if (isWorker && workers_[worker]->readyQueues[priority].pop(handleOut))
+		{
+			stats_.affinityHits.fetch_add(1, std::memory_order::relaxed);
+			readyJobs_.fetch_sub(1, std::memory_order::relaxed);
+			return true;
+		}
+
+		if (readyQueues_[priority].pop(handleOut))
+		{
+			if (handleOut->promise().affinity != 0)
+				stats_.affinityMisses.fetch_add(1, std::memory_order::relaxed);
+			readyJobs_.fetch_sub(1, std::memory_order::relaxed);
+			return true;
+		}
+
+		// the preferred worker is busy (or parked), take its affinity jobs instead of idling
+		for (size_t i = 0; i < workers_.size(); i++)
+		{
+			if (i != worker && workers_[i]->readyQueues[priority].popWeak(handleOut))
+			{
+				stats_.affinitySteals.fetch_add(1, std::memory_order::relaxed);
+				readyJobs_.fetch_sub(1, std::memory_order::relaxed);
 				return true;
 			}
-			return false;
 		}
 
 		return false;
 	}
 
-	Counter* JobScheduler::runJobs(JobInfo* jobs, size_t jobsCount)
+	void JobScheduler::pushReady(JobHandle handle)
+	{
+		Job::promise_type& promise = handle.promise();
+		size_t priority = static_cast<size_t>(promise.priority);
+
+		size_t owner = noWorker_;
+
+		if (promise.affinity != 0)
+			owner = affinityOwners_[affinitySlot(promise.affinity)].load(std::memory_order::relaxed);
+
+		// counted before the push so a concurrent pop can't take the count below zero
+		size_t readyJobs = readyJobs_.fetch_add(1, std::memory_order::relaxed) + 1;
+
+		if (owner < workers_.size() && !workers_[owner]->isParked.load(std::memory_order::acquire))
+			workers_[owner]->readyQueues[priority].push(handle);
+		else
+			readyQueues_[priority].push(handle);
+
+		if (parkedWorkers_.load(std::memory_order::relaxed) > 0 && readyJobs > activeWorkers_.load(std::memory_order::relaxed) * ENGINE_JOB_SYSTEM_UNPARK_DEPTH)
+			unparkWorker();
+	}
+
+	void JobScheduler::setAdmissionPolicy(JobPriority priority, AdmissionPolicy policy, size_t maxJobs)
+	{
+		size_t index = static_cast<size_t>(priority);
+		admissionPolicies_[index] = policy;
+		admissionLimits_[index] = maxJobs;
+	}
+
+	bool JobScheduler::tryAdmit(size_t priority, size_t jobsCount)
+	{
+		size_t limit = admissionLimits_[priority] == 0 ? maxJobs_ : admissionLimits_[priority];
+
+		// a batch bigger than the limit is only admitted into an empty class, otherwise it could never run
+		size_t active = activeJobs_[priority].load(std::memory_order::acquire);
+		do
+		{
+			if (active != 0 && active + jobsCount > limit)
+				return false;
+		} while (!activeJobs_[priority].compare_exchange_weak(active, active + jobsCount, std::memory_order::acq_rel));
+
+		size_t total = totalActiveJobs_.load(std::memory_order::acquire);
+		do
+		{
+			if (total != 0 && total + jobsCount > maxJobs_)
+			{
+				activeJobs_[priority].fetch_sub(jobsCount, std::memory_order::acq_rel);
+				return false;
+			}
+		} while (!totalActiveJobs_.compare_exchange_weak(total, total + jobsCount, std::memory_order::acq_rel));
+
+		return true;
+	}
+
+	void JobScheduler::releaseAdmission(size_t priority, size_t jobsCount)
+	{
+		activeJobs_[priority].fetch_sub(jobsCount, std::memory_order::acq_rel);
+		totalActiveJobs_.fetch_sub(jobsCount, std::memory_order::acq_rel);
+	}
+
+	bool JobScheduler::admit(const size_t* jobsPerPriority)
+	{
+		for (size_t i = 0; i < priorityCount_; i++)
+		{
+			if (jobsPerPriority[i] == 0)
+				continue;
+
+			while (!tryAdmit(i, jobsPerPriority[i]))
+			{
+				AdmissionPolicy policy = admissionPolicies_[i];
+
+				// other threads (e.g. the asset I/O threads) must not pick up game jobs, they wait like BLOCK instead,
+				// or are rejected if no worker is running that could ever make room
+				if (policy == AdmissionPolicy::HELP && workerIndex_ >= workers_.size())
+					policy = threadsRunning_.load(std::memory_order::acquire) == 1 ? AdmissionPolicy::BLOCK : AdmissionPolicy::REJECT;
+
+				switch (policy)
+				{
+				case AdmissionPolicy::REJECT:
+					ENGINE_FLIGHT_EVENT(JOBS, "rejected ", jobsPerPriority[i], " jobs of priority ", i);
+					for (size_t j = 0; j < i; j++)
+						if (jobsPerPriority[j] != 0)
+							releaseAdmission(j, jobsPerPriority[j]);
+					return false;
+				case AdmissionPolicy::HELP:
+					execNext();
+					break;
+				case AdmissionPolicy::BLOCK:
+				default:
+					std::this_thread::yield();
+					break;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	SubmitStatus JobScheduler::submitJobs(JobInfo* jobs, size_t jobsCount, Counter** counterOut)
 	{
+		size_t jobsPerPriority[priorityCount_] = {};
+
+		for (size_t i = 0; i < jobsCount; i++)
+			jobsPerPriority[static_cast<size_t>(jobs[i].priority)]++;
+
+		if (!admit(jobsPerPriority))
+			return SubmitStatus::REJECTED;
+
 		Counter* c = new Counter(0);
 		c->store(jobsCount, std::memory_order::relaxed);
 
 		for (size_t i = 0; i < jobsCount; i++)
-			readyQueue_.push(jobs[i].function(c, this, this->engine(), jobs[i].arg));
+		{
+			JobHandle handle = jobs[i].function(c, this, this->engine(), jobs[i].arg);
+			handle.promise().priority = jobs[i].priority;
+			handle.promise().affinity = jobs[i].affinity;
+			handle.promise().deadline = jobs[i].deadline;
+			pushReady(handle);
+		}
+
+		if (counterOut != nullptr)
+			*counterOut = c;
+
+		return SubmitStatus::SUBMITTED;
+	}
 
+	Counter* JobScheduler::runJobs(JobInfo* jobs, size_t jobsCount)
+	{
+		Counter* c = nullptr;
+		if (submitJobs(jobs, jobsCount, &c) == SubmitStatus::REJECTED)
+			return nullptr;
 		return c;
 	}
 
@@ -81,6 +369,9 @@ namespace NovaEngine::JobSystem
 	void JobScheduler::stopThreads()
 	{
 		threadsRunning_.store(0);
+
+		InstrumentedLock lock(parkMutex_);
+		parkCv_.notify_all();
 	}
 
 	void JobScheduler::joinThreads()
@@ -92,9 +383,17 @@ namespace NovaEngine::JobSystem
 
 	void JobScheduler::initThreads()
 	{
+		// one worker slot per execution thread plus one for the main thread
+		if (workers_.size() == 0)
+			for (size_t i = 0; i <= executionThreads_; i++)
+				workers_.push_back(std::make_unique<Worker>());
+
 		if (threads_.size() == 0)
+		{
+			activeWorkers_.store(executionThreads_, std::memory_order::release);
 			for (size_t i = 0; i < executionThreads_; i++)
-				threads_.push_back(std::thread([&] { threadEntry(threadIdCounter.fetch_add(1, std::memory_order::acq_rel)); }));
+				threads_.push_back(std::thread([this, i] { threadEntry(i); }));
+		}
 	}
 
 	bool JobScheduler::handleJobYield(JobHandlePtr handle)
@@ -105,7 +404,7 @@ namespace NovaEngine::JobSystem
 		}
 		else
 		{
-			std::unique_lock<std::mutex> s(jobYieldMutex_);
+			InstrumentedLock s(jobYieldMutex_);
 
 			auto [counter, isDone] = handle->promise().state;
 
@@ -114,7 +413,7 @@ namespace NovaEngine::JobSystem
 				size_t c = counter->load(std::memory_order::seq_cst);
 				if (c == 0)
 				{
-					readyQueue_.push(*handle);
+					pushReady(*handle);
 				}
 				else
 				{
@@ -123,7 +422,7 @@ namespace NovaEngine::JobSystem
 						c = counter->load(std::memory_order::seq_cst);
 						if (c == 0)
 						{
-							readyQueue_.push(*handle);
+							pushReady(*handle);
 							return true;
 						}
 					}
@@ -133,17 +432,30 @@ namespace NovaEngine::JobSystem
 			{
 				size_t index = counter->fetch_sub(1, std::memory_order::acq_rel) - 1;
 
+				JobDeadline deadline = handle->promise().deadline;
+				if (deadline != noDeadline)
+				{
+					stats_.deadlineJobs.fetch_add(1, std::memory_order::relaxed);
+					if (std::chrono::steady_clock::now() > deadline)
+					{
+						stats_.missedDeadlines.fetch_add(1, std::memory_order::relaxed);
+						ENGINE_FLIGHT_EVENT(JOBS, "job missed its deadline by ", std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - deadline).count(), "us");
+					}
+				}
+
+				releaseAdmission(static_cast<size_t>(handle->promise().priority), 1);
+				handle->destroy();
+
 				if (index == 0)
 				{
 					waitList_.findAndRelease([&](JobHandle handle) {
 						if (handle.promise().state.counter == counter)
 						{
-							readyQueue_.push(handle);
+							pushReady(handle);
 							return true;
 						}
 						return false;
 					});
-					handle->destroy();
 
 					delete counter;
 				}
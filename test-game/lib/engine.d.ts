@@ -15,6 +15,18 @@ declare namespace Engine
 	const window: Window;
 
 	const start: () => boolean;
+
+	/** logs acquire and contention statistics of the engine's locks */
+	const reportLocks: () => void;
+
+	/** logs hit rate, evictions and resident bytes of the asset cache */
+	const reportAssets: () => void;
+
+	/** sets the lowest logged level of a category, or of all categories when none is given */
+	const setLogLevel: (level: LogLevel, category?: LogCategory) => void;
+
+	/** reads an asset (relative to the assets directory) without blocking the game, rejects if it could not be loaded */
+	const loadText: (path: string) => Promise<string>;
 }
 
 type EngineConfigureFunction = (config: EngineConfiguration) => Promise<void>;
@@ -22,6 +34,36 @@ type EngineConfigureFunction = (config: EngineConfiguration) => Promise<void>;
 type EngineConfiguration = {
 	name: string;
 	window?: WindowConfig;
+	jobs?: JobsConfig;
+	assets?: AssetsConfig;
+	log?: LogConfig;
+};
+
+type LogLevel = "verbose" | "info" | "warn" | "error";
+
+type LogCategory = "general" | "jobs" | "graphics" | "script" | "asset";
+
+type LogConfig = {
+	/** lowest logged level for every category (default "info") */
+	level?: LogLevel;
+	/** overrides the level per category */
+	categories?: { [category in LogCategory]?: LogLevel };
+};
+
+type JobsConfig = {
+	/** worker threads that always stay awake (default 1) */
+	minWorkers?: number;
+	/** worker threads that are created and woken under load (default: one per hardware thread besides the main thread) */
+	maxWorkers?: number;
+};
+
+type AssetsConfig = {
+	/** megabytes of assets that stay cached after they are no longer used (default 256) */
+	cacheBudget?: number;
+	/** watch out/assets and rerun changed scripts without restarting the engine (default false) */
+	hotReload?: boolean;
+	/** record which assets this run loads, later runs read them ahead at startup (default false) */
+	recordPrefetch?: boolean;
 };
 
 type WindowConfig = {
@@ -0,0 +1,589 @@
+#include "AssetDependencies.hpp"
+#include "BlockCompression.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+/**
+ * Turns source assets into the files the engine loads at runtime:
+ *   shaders (.vert, .frag, ...)  ->  <name>.spv compiled by glslc
+ *   .json                        ->  <name>.json.js, minified and wrapped into the module the ScriptManager would build
+ *   everything else              ->  copied
+ *
+ * With --compress every output that gets smaller is written as block compressed container (BlockCompression.hpp),
+ * the AssetManager decompresses those transparently.
+ *
+ * The require() calls of every script in the output directory are written into AssetDependencies::fileName,
+ * so the engine can load a script together with everything it requires.
+ *
+ * Cooked results are stored in the cache directory under a hash of the cooker and the input content,
+ * so unchanged inputs are never cooked twice, not even after a clean of the output directory.
+ * Shaders also hash the glslc version and flags and the content of every file they include (as reported by glslc -MD).
+ */
+namespace fs = std::filesystem;
+
+namespace
+{
+	/* bumped whenever a cooker changes its output, so old cache entries are not reused */
+	constexpr uint32_t cookerVersion = 1;
+
+	enum class Cooker
+	{
+		COPY,
+		SHADER,
+		JSON,
+	};
+
+	struct Input
+	{
+		fs::path source;
+		fs::path output;
+		std::string name; // relative to the output directory, for reporting
+		Cooker cooker;
+	};
+
+	struct Result
+	{
+		std::atomic<size_t> cooked;
+		std::atomic<size_t> cached;
+		std::atomic<size_t> unchanged;
+		std::atomic<size_t> failed;
+	};
+
+	std::mutex outputMutex;
+	bool isCompressing = false;
+
+	/* passed to every glslc call, part of the shader cache key together with the glslc version */
+	constexpr const char* shaderFlags = "";
+	std::string shaderCompilerVersion;
+
+	const char* cookerName(Cooker cooker)
+	{
+		switch (cooker)
+		{
+		case Cooker::SHADER: return "shader";
+		case Cooker::JSON: return "json";
+		default: return "copy";
+		}
+	}
+
+	uint64_t hash(const char* data, size_t size, uint64_t hash = 14695981039346656037ull)
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= static_cast<unsigned char>(data[i]);
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	bool readFile(const fs::path& path, std::string& content)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+
+		content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return true;
+	}
+
+	/* written next to the target and renamed over it, readers never see a partial file */
+	bool writeFile(const fs::path& path, const std::string& content)
+	{
+		// workers and other cooker processes may write the same cache entry at once, each needs its own temp file
+		static std::atomic<uint64_t> tempCounter = 0;
+
+		fs::path tempPath = path;
+		tempPath += "." + std::to_string(getpid()) + "." + std::to_string(tempCounter.fetch_add(1, std::memory_order_relaxed)) + ".tmp";
+
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			file.write(content.data(), content.size());
+			if (!file)
+				return false;
+		}
+
+		std::error_code error;
+		fs::rename(tempPath, path, error);
+		return !error;
+	}
+
+	void report(const char* status, const Input& input)
+	{
+		std::lock_guard<std::mutex> lock(outputMutex);
+		std::cout << status << " " << input.name << std::endl;
+	}
+
+	void reportError(const Input& input, const std::string& message)
+	{
+		std::lock_guard<std::mutex> lock(outputMutex);
+		std::cerr << "failed to cook " << input.source.string() << ": " << message << std::endl;
+	}
+
+	/* drops whitespace outside of strings, the parser still validates the result when it is loaded */
+	std::string minifyJson(const std::string& json)
+	{
+		std::string result;
+		result.reserve(json.size());
+
+		bool isString = false;
+		bool isEscaped = false;
+
+		for (char c : json)
+		{
+			if (isString)
+			{
+				result += c;
+
+				if (isEscaped)
+					isEscaped = false;
+				else if (c == '\\')
+					isEscaped = true;
+				else if (c == '"')
+					isString = false;
+			}
+			else if (c == '"')
+			{
+				isString = true;
+				result += c;
+			}
+			else if (c != ' ' && c != '\t' && c != '\n' && c != '\r')
+			{
+				result += c;
+			}
+		}
+
+		return result;
+	}
+
+	/** @returns the output of glslc --version, empty if glslc could not be run */
+	std::string readShaderCompilerVersion()
+	{
+		FILE* pipe = popen("glslc --version 2>/dev/null", "r");
+		if (pipe == nullptr)
+			return "";
+
+		std::string version;
+		char buffer[256];
+		size_t length;
+		while ((length = fread(buffer, 1, sizeof(buffer), pipe)) > 0)
+			version.append(buffer, length);
+
+		return pclose(pipe) == 0 ? version : "";
+	}
+
+	/* the prerequisites of a make rule written by glslc -MD, without the shader itself */
+	void parseIncludes(const std::string& rule, const fs::path& source, std::vector<std::string>& includes)
+	{
+		size_t position = rule.find(": ");
+		if (position == std::string::npos)
+			return;
+
+		std::string path;
+		for (position += 2; position <= rule.size(); position++)
+		{
+			char c = position < rule.size() ? rule[position] : '\n';
+
+			// escaped spaces belong to the path, a backslash before a newline continues the rule
+			if (c == '\\' && position + 1 < rule.size() && rule[position + 1] != '\n')
+			{
+				path += rule[++position];
+				continue;
+			}
+
+			if (c != ' ' && c != '\t' && c != '\n' && c != '\r' && c != '\\')
+			{
+				path += c;
+				continue;
+			}
+
+			if (!path.empty() && fs::path(path) != source)
+				includes.push_back(path);
+			path.clear();
+		}
+	}
+
+	bool cookShader(const Input& input, std::string& cooked, std::vector<std::string>& includes)
+	{
+		fs::path spirvPath = fs::temp_directory_path() / ("nova-cook-" + std::to_string(std::hash<std::string>()(input.source.string())) + ".spv");
+		fs::path rulePath = spirvPath;
+		rulePath += ".d";
+
+		std::string command = std::string("glslc ") + shaderFlags + " -MD -MF \"" + rulePath.string() + "\" \"" + input.source.string() + "\" -o \"" + spirvPath.string() + "\"";
+
+		if (std::system(command.c_str()) != 0)
+		{
+			reportError(input, "glslc failed");
+			fs::remove(rulePath);
+			return false;
+		}
+
+		std::string rule;
+		if (readFile(rulePath, rule))
+			parseIncludes(rule, input.source, includes);
+
+		bool isRead = readFile(spirvPath, cooked);
+		fs::remove(spirvPath);
+		fs::remove(rulePath);
+		return isRead;
+	}
+
+	/* folds the path and content of every include into the hash, a missing include hashes like an empty one */
+	uint64_t hashIncludes(const std::vector<std::string>& includes, uint64_t contentHash)
+	{
+		for (const std::string& include : includes)
+		{
+			std::string content;
+			readFile(include, content);
+
+			contentHash = hash(include.data(), include.size() + 1, contentHash);
+			contentHash = hash(content.data(), content.size(), contentHash);
+		}
+
+		return contentHash;
+	}
+
+	std::string hashName(uint64_t contentHash)
+	{
+		char name[17];
+		snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(contentHash));
+		return name;
+	}
+
+	bool cook(const Input& input, const std::string& content, std::string& cooked, std::vector<std::string>& includes)
+	{
+		switch (input.cooker)
+		{
+		case Cooker::SHADER:
+			if (!cookShader(input, cooked, includes))
+				return false;
+			break;
+
+		case Cooker::JSON:
+			// the same module ScriptManager would wrap around the raw json
+			cooked = "exports.data = " + minifyJson(content) + ";";
+			break;
+
+		default:
+			cooked = content;
+			break;
+		}
+
+		if (isCompressing)
+			NovaEngine::BlockCompression::compressIfSmaller(cooked.data(), cooked.size(), cooked);
+
+		return true;
+	}
+
+	void process(const Input& input, const fs::path& cacheDir, Result& result)
+	{
+		std::string content;
+		if (!readFile(input.source, content))
+		{
+			reportError(input, "could not read the input");
+			result.failed++;
+			return;
+		}
+
+		// plain copies are cheap enough to skip the cache
+		if (input.cooker == Cooker::COPY && !isCompressing)
+		{
+			std::string existing;
+			if (readFile(input.output, existing) && existing == content)
+			{
+				result.unchanged++;
+				return;
+			}
+
+			if (!writeFile(input.output, content))
+			{
+				reportError(input, "could not write " + input.output.string());
+				result.failed++;
+				return;
+			}
+
+			result.cooked++;
+			report("copied", input);
+			return;
+		}
+
+		std::string key = cookerName(input.cooker) + std::to_string(cookerVersion) + (isCompressing ? "+lz" : "");
+		if (input.cooker == Cooker::SHADER)
+			key += std::string("+") + shaderFlags + "+" + shaderCompilerVersion;
+
+		uint64_t contentHash = hash(content.data(), content.size(), hash(key.data(), key.size()));
+
+		// the includes a shader had when it was last cooked, an edited include changes the key,
+		// one that adds or removes includes is edited itself, so the list can be refreshed whenever the shader is cooked.
+		// the same shader in another directory resolves its includes elsewhere, so the list also depends on the source path
+		std::string sourcePath = fs::absolute(input.source).lexically_normal().string();
+		fs::path includesPath = cacheDir / (hashName(hash(sourcePath.data(), sourcePath.size(), contentHash)) + ".includes");
+		std::vector<std::string> includes;
+
+		std::string includeList;
+		if (input.cooker == Cooker::SHADER && readFile(includesPath, includeList))
+		{
+			for (size_t start = 0, end; start < includeList.size(); start = end + 1)
+			{
+				end = includeList.find('\n', start);
+				if (end == std::string::npos)
+					end = includeList.size();
+				if (end > start)
+					includes.push_back(includeList.substr(start, end - start));
+			}
+		}
+
+		fs::path cachePath = cacheDir / hashName(hashIncludes(includes, contentHash));
+
+		std::string cooked;
+		bool isCached = readFile(cachePath, cooked);
+
+		if (!isCached)
+		{
+			includes.clear();
+			if (!cook(input, content, cooked, includes))
+			{
+				result.failed++;
+				return;
+			}
+
+			if (input.cooker == Cooker::SHADER)
+			{
+				includeList.clear();
+				for (const std::string& include : includes)
+					includeList += include + "\n";
+
+				writeFile(includesPath, includeList);
+				cachePath = cacheDir / hashName(hashIncludes(includes, contentHash));
+			}
+
+			writeFile(cachePath, cooked);
+		}
+
+		std::string existing;
+		if (readFile(input.output, existing) && existing == cooked)
+		{
+			result.unchanged++;
+			return;
+		}
+
+		if (!writeFile(input.output, cooked))
+		{
+			reportError(input, "could not write " + input.output.string());
+			result.failed++;
+			return;
+		}
+
+		if (isCached)
+		{
+			result.cached++;
+			report("restored", input);
+		}
+		else
+		{
+			result.cooked++;
+			report("cooked", input);
+		}
+	}
+
+	Cooker cookerFor(const fs::path& path, std::string* outputName)
+	{
+		static const char* shaderExtensions[] = { ".vert", ".frag", ".comp", ".geom", ".tesc", ".tese" };
+
+		std::string extension = path.extension().string();
+		*outputName = path.filename().string();
+
+		if (std::find(std::begin(shaderExtensions), std::end(shaderExtensions), extension) != std::end(shaderExtensions))
+		{
+			*outputName += ".spv";
+			return Cooker::SHADER;
+		}
+
+		if (extension == ".json")
+		{
+			*outputName += ".js";
+			return Cooker::JSON;
+		}
+
+		return Cooker::COPY;
+	}
+
+	/* resolves like ScriptManager::handleRequire, relative to the requiring module, json modules prefer their cooked form */
+	bool resolveRequire(const fs::path& outputDir, const fs::path& moduleDir, const std::string& required, std::string& dependency)
+	{
+		fs::path target = (moduleDir / required).lexically_normal();
+		dependency = target.generic_string();
+
+		if (target.extension() != ".json")
+			dependency += ".js";
+		else if (fs::is_regular_file(outputDir / (dependency + ".js")))
+			dependency += ".js";
+
+		return fs::is_regular_file(outputDir / dependency);
+	}
+
+	/* scans the output instead of the inputs, compiled scripts are not cooked but only live in the output directory */
+	bool writeDependencies(const fs::path& outputDir)
+	{
+		NovaEngine::AssetDependencies::Graph graph;
+
+		for (const auto& entry : fs::recursive_directory_iterator(outputDir))
+		{
+			std::string name = entry.path().filename().string();
+			if (!entry.is_regular_file() || entry.path().extension() != ".js" || name.ends_with(".json.js"))
+				continue;
+
+			std::string script;
+			if (!readFile(entry.path(), script))
+				continue;
+
+			if (NovaEngine::BlockCompression::isCompressed(script.data(), script.size()))
+			{
+				std::string decompressed;
+				if (!NovaEngine::BlockCompression::decompress(script.data(), script.size(), decompressed))
+					continue;
+				script = std::move(decompressed);
+			}
+
+			std::vector<std::string> requiredPaths;
+			NovaEngine::AssetDependencies::findRequires(script, requiredPaths);
+
+			fs::path relative = entry.path().lexically_relative(outputDir);
+			std::vector<std::string> dependencies;
+
+			for (const std::string& required : requiredPaths)
+			{
+				std::string dependency;
+				if (resolveRequire(outputDir, relative.parent_path(), required, dependency) && std::find(dependencies.begin(), dependencies.end(), dependency) == dependencies.end())
+					dependencies.push_back(std::move(dependency));
+			}
+
+			if (!dependencies.empty())
+				graph[relative.generic_string()] = std::move(dependencies);
+		}
+
+		std::string text = NovaEngine::AssetDependencies::format(graph);
+		fs::path path = outputDir / NovaEngine::AssetDependencies::fileName;
+
+		std::string existing;
+		if (readFile(path, existing) && existing == text)
+			return true;
+
+		if (!writeFile(path, text))
+		{
+			std::cerr << "could not write " << path.string() << std::endl;
+			return false;
+		}
+
+		std::cout << "recorded the dependencies of " << graph.size() << " assets" << std::endl;
+		return true;
+	}
+
+	/* <source dir>[=<directory inside the output dir>] */
+	bool collect(const std::string& argument, const fs::path& outputDir, std::vector<Input>& inputs)
+	{
+		size_t separator = argument.find('=');
+		fs::path sourceDir = argument.substr(0, separator);
+		fs::path targetDir = separator == std::string::npos ? fs::path() : fs::path(argument.substr(separator + 1));
+
+		if (!fs::is_directory(sourceDir))
+		{
+			std::cerr << sourceDir.string() << " is not a directory" << std::endl;
+			return false;
+		}
+
+		for (const auto& entry : fs::recursive_directory_iterator(sourceDir))
+		{
+			if (!entry.is_regular_file() || entry.path().extension() == ".tmp")
+				continue;
+
+			std::string outputName;
+			Cooker cooker = cookerFor(entry.path(), &outputName);
+
+			fs::path relative = targetDir / entry.path().lexically_relative(sourceDir).parent_path() / outputName;
+			fs::path output = outputDir / relative;
+
+			// sources that already live in the output directory (e.g. compiled scripts) only need cooking, not copying
+			std::error_code error;
+			if (cooker == Cooker::COPY && fs::equivalent(entry.path(), output, error))
+				continue;
+
+			inputs.push_back({ entry.path(), output, relative.generic_string(), cooker });
+		}
+
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const char* program = argv[0];
+
+	isCompressing = argc > 1 && strcmp(argv[1], "--compress") == 0;
+	if (isCompressing)
+	{
+		argc--;
+		argv++;
+	}
+
+	if (argc < 4)
+	{
+		std::cerr << "usage: " << program << " [--compress] <cache dir> <output dir> <source dir>[=<output subdir>]..." << std::endl;
+		return 1;
+	}
+
+	fs::path cacheDir = argv[1];
+	fs::path outputDir = argv[2];
+
+	std::vector<Input> inputs;
+	for (int i = 3; i < argc; i++)
+		if (!collect(argv[i], outputDir, inputs))
+			return 1;
+
+	fs::create_directories(cacheDir);
+	for (const Input& input : inputs)
+		fs::create_directories(input.output.parent_path());
+
+	// shaders cooked by another glslc are cooked again
+	if (std::any_of(inputs.begin(), inputs.end(), [](const Input& input) { return input.cooker == Cooker::SHADER; }))
+		shaderCompilerVersion = readShaderCompilerVersion();
+
+	Result result = {};
+	std::atomic<size_t> next = 0;
+
+	size_t threadCount = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), inputs.size()));
+	std::vector<std::thread> threads;
+
+	for (size_t t = 0; t < threadCount; t++)
+	{
+		threads.emplace_back([&] {
+			for (size_t i = next++; i < inputs.size(); i = next++)
+				process(inputs[i], cacheDir, result);
+		});
+	}
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	std::cout << inputs.size() << " assets: " << result.cooked.load() << " cooked, " << result.cached.load() << " restored from cache, "
+		<< result.unchanged.load() << " unchanged, " << result.failed.load() << " failed" << std::endl;
+
+	if (!writeDependencies(outputDir))
+		return 1;
+
+	return result.failed.load() == 0 ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+#include "AssetArchive.hpp"
+#include "BlockCompression.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace NovaEngine;
+
+namespace
+{
+	struct File
+	{
+		std::string name;
+		std::filesystem::path path;
+		uint64_t size;
+		std::string compressed; // stored instead of the file when it is not empty
+	};
+
+	void compress(File& file)
+	{
+		std::ifstream in(file.path, std::ios::binary);
+		std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+		if (BlockCompression::compressIfSmaller(content.data(), content.size(), file.compressed))
+			file.size = file.compressed.size();
+	}
+
+	void pad(std::ofstream& out, uint64_t offset)
+	{
+		static const char zeros[AssetArchive::sectionAlignment] = {};
+		uint64_t position = static_cast<uint64_t>(out.tellp());
+		out.write(zeros, offset - position);
+	}
+
+	bool pack(const std::filesystem::path& assetsDir, const std::filesystem::path& outputPath, bool isCompressed)
+	{
+		std::vector<File> files;
+
+		for (const auto& entry : std::filesystem::recursive_directory_iterator(assetsDir))
+		{
+			if (!entry.is_regular_file())
+				continue;
+
+			files.push_back({ entry.path().lexically_relative(assetsDir).generic_string(), entry.path(), entry.file_size() });
+		}
+
+		// sorted so the same assets always produce the same archive
+		std::sort(files.begin(), files.end(), [](const File& a, const File& b) { return a.name < b.name; });
+
+		if (isCompressed)
+			for (File& file : files)
+				compress(file);
+
+		AssetArchive::Header header = {};
+		memcpy(header.magic, AssetArchive::fileMagic, sizeof(header.magic));
+		header.version = AssetArchive::fileVersion;
+		header.entryCount = static_cast<uint32_t>(files.size());
+		header.bucketCount = AssetArchive::bucketCountFor(header.entryCount);
+		header.namesOffset = sizeof(AssetArchive::Header) + static_cast<uint64_t>(header.bucketCount) * sizeof(AssetArchive::Entry);
+
+		std::vector<AssetArchive::Entry> table(header.bucketCount);
+		std::string names;
+		uint64_t dataSize = 0;
+
+		for (const File& file : files)
+		{
+			AssetArchive::Entry entry = {};
+			entry.hash = AssetArchive::hash(file.name);
+			entry.nameOffset = static_cast<uint32_t>(names.size());
+			entry.nameLength = static_cast<uint32_t>(file.name.size());
+			entry.offset = dataSize;
+			entry.size = file.size;
+
+			names += file.name;
+			dataSize = AssetArchive::alignUp(dataSize + file.size, AssetArchive::dataAlignment);
+
+			uint32_t mask = header.bucketCount - 1;
+			uint32_t bucket = static_cast<uint32_t>(entry.hash) & mask;
+			while (table[bucket].hash != 0)
+				bucket = (bucket + 1) & mask;
+
+			table[bucket] = entry;
+		}
+
+		header.dataOffset = AssetArchive::alignUp(header.namesOffset + names.size(), AssetArchive::sectionAlignment);
+
+		for (AssetArchive::Entry& entry : table)
+			if (entry.hash != 0)
+				entry.offset += header.dataOffset;
+
+		// written next to the archive and renamed over it, a running engine never maps a half written archive
+		std::filesystem::path tempPath = outputPath;
+		tempPath += ".tmp";
+
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out)
+		{
+			std::cerr << "could not create " << tempPath << std::endl;
+			return false;
+		}
+
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(AssetArchive::Entry));
+		out.write(names.data(), names.size());
+
+		uint64_t offset = header.dataOffset;
+		for (const File& file : files)
+		{
+			pad(out, offset);
+
+			// inserting an empty stream would set the failbit of out
+			if (!file.compressed.empty())
+			{
+				out.write(file.compressed.data(), file.compressed.size());
+			}
+			else if (file.size > 0)
+			{
+				std::ifstream in(file.path, std::ios::binary);
+				out << in.rdbuf();
+			}
+
+			if (static_cast<uint64_t>(out.tellp()) != offset + file.size)
+			{
+				std::cerr << "could not read " << file.path << std::endl;
+				return false;
+			}
+
+			offset = AssetArchive::alignUp(offset + file.size, AssetArchive::dataAlignment);
+		}
+
+		out.close();
+		if (!out)
+		{
+			std::cerr << "could not write " << tempPath << std::endl;
+			return false;
+		}
+
+		std::filesystem::rename(tempPath, outputPath);
+
+		std::cout << "packed " << files.size() << " assets (" << offset << " bytes) into " << outputPath.string() << std::endl;
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const char* program = argv[0];
+
+	// --compress stores every asset that gets smaller as block compressed container
+	bool isCompressed = argc > 1 && strcmp(argv[1], "--compress") == 0;
+	if (isCompressed)
+	{
+		argc--;
+		argv++;
+	}
+
+	if (argc < 3)
+	{
+		std::cerr << "usage: " << program << " [--compress] <assets dir> <output.pak>" << std::endl;
+		return 1;
+	}
+
+	if (!std::filesystem::is_directory(argv[1]))
+	{
+		std::cerr << argv[1] << " is not a directory" << std::endl;
+		return 1;
+	}
+
+	return pack(argv[1], argv[2], isCompressed) ? 0 : 1;
+}
@@ -0,0 +1,124 @@
+#include "LogFormat.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+#include <unordered_map>
+
+using namespace NovaEngine;
+
+namespace
+{
+	template<typename T>
+	bool read(const std::vector<char>& data, size_t& offset, T* value)
+	{
+		if (data.size() - offset < sizeof(T))
+			return false;
+
+		memcpy(value, &data[offset], sizeof(T));
+		offset += sizeof(T);
+		return true;
+	}
+
+	bool decode(const std::vector<char>& data, std::ostream& out)
+	{
+		size_t offset = 0;
+		LogFormat::FileHeader fileHeader;
+
+		if (!read(data, offset, &fileHeader) || memcmp(fileHeader.magic, LogFormat::fileMagic, sizeof(fileHeader.magic)) != 0)
+		{
+			std::cerr << "not a binary log file" << std::endl;
+			return false;
+		}
+
+		if (fileHeader.version != LogFormat::fileVersion)
+		{
+			std::cerr << "unsupported log file version " << fileHeader.version << std::endl;
+			return false;
+		}
+
+		std::unordered_map<uint32_t, std::vector<LogFormat::ArgType>> formats;
+		std::string line;
+		uint32_t tag;
+
+		while (read(data, offset, &tag))
+		{
+			// the preallocated tail of a segment that was not closed properly
+			if (tag == 0)
+			{
+				offset = data.size();
+				break;
+			}
+
+			if (tag == LogFormat::formatTag)
+			{
+				uint32_t formatId;
+				uint32_t argCount;
+
+				if (!read(data, offset, &formatId) || !read(data, offset, &argCount) || data.size() - offset < argCount)
+					break;
+
+				std::vector<LogFormat::ArgType>& types = formats[formatId];
+				types.resize(argCount);
+				memcpy(types.data(), &data[offset], argCount);
+				offset += argCount;
+			}
+			else if (tag == LogFormat::recordTag)
+			{
+				LogFormat::RecordHeader header;
+
+				if (!read(data, offset, &header) || data.size() - offset < header.argsSize)
+					break;
+
+				auto format = formats.find(header.formatId);
+
+				line.clear();
+				if (format == formats.end())
+					LogFormat::appendLine(line, header, nullptr, 0, nullptr);
+				else
+					LogFormat::appendLine(line, header, format->second.data(), format->second.size(), &data[offset]);
+
+				out << line;
+				offset += header.argsSize;
+			}
+			else
+			{
+				std::cerr << "corrupted entry at offset " << offset - sizeof(tag) << std::endl;
+				return false;
+			}
+		}
+
+		// the engine may have been killed in the middle of a write
+		if (offset != data.size())
+			std::cerr << "truncated entry at the end of the file" << std::endl;
+
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cerr << "usage: " << argv[0] << " <segment.nlg> [output.log]" << std::endl;
+		return 1;
+	}
+
+	std::ifstream file(argv[1], std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "could not open " << argv[1] << std::endl;
+		return 1;
+	}
+
+	std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	if (argc > 2)
+	{
+		std::ofstream out(argv[2]);
+		return decode(data, out) ? 0 : 1;
+	}
+
+	return decode(data, std::cout) ? 0 : 1;
+}